@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""Accuracy of a MIXED_PRECISION build against the all-double build.
+
+Runs one deck (default MIS, a voltage sweep) with both executables and the
+reduced diagnostics written every step, then reports the largest differences,
+relative to the scale of each quantity in the double run, of
+  - the hysteresis loop: Pz_FE and Q_top at the converged (last) row of each
+    applied voltage
+  - the steady state: the number of steps each voltage took to converge
+  - the transient: Pz_FE and Q_top on every step both runs reached
+  - the final state: the Fingerprint norms of Px, Py, Pz and Phi
+
+  python3 compare_precision.py --exe ../main3d.gnu.MPI.ex --exe-mp ../main3d.gnu.MPI.MP.ex --nsteps 5000
+"""
+
+import argparse
+import csv
+import os
+import shlex
+import subprocess
+import sys
+
+from regression import FINGERPRINT, HERE, find_inputs
+
+LOOP_COLUMNS = ("Pz_FE", "Q_top")
+
+
+def run(exe, deck, tag, args):
+    run_dir = os.path.join(os.path.abspath(args.workdir), tag)
+    os.makedirs(run_dir, exist_ok=True)
+    overrides = ["nsteps={}".format(args.nsteps),
+                 "random_seed={}".format(args.seed),
+                 "plot_int=-1",
+                 "chk_int=-1",
+                 "diag_int=1",
+                 "diag_file=diagnostics.csv"]
+    cmd = shlex.split(args.mpi) + [os.path.abspath(exe), find_inputs(os.path.join(HERE, deck))] + overrides
+    proc = subprocess.run(cmd, cwd=run_dir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                          universal_newlines=True)
+    with open(os.path.join(run_dir, "stdout.txt"), "w") as log:
+        log.write(proc.stdout)
+    if proc.returncode != 0:
+        sys.exit("{} run failed with exit code {} (see {})".format(tag, proc.returncode, run_dir))
+
+    fingerprints = {}
+    for line in proc.stdout.splitlines():
+        m = FINGERPRINT.match(line.strip())
+        if m:
+            for key, val in zip(("norm0", "norm1", "norm2"), m.groups()[1:]):
+                fingerprints["{}.{}".format(m.group(1), key)] = float(val)
+
+    with open(os.path.join(run_dir, "diagnostics.csv")) as f:
+        rows = [{k: float(v) for k, v in r.items()} for r in csv.DictReader(f)]
+    return rows, fingerprints
+
+
+def voltages(rows):
+    """Rows grouped by applied voltage, in order of application."""
+    groups = []
+    for r in rows:
+        if not groups or r["Phi_Bc_hi"] != groups[-1][0]["Phi_Bc_hi"]:
+            groups.append([])
+        groups[-1].append(r)
+    return groups
+
+
+def rel(a, b, scale):
+    return abs(a - b) / max(scale, 1.e-300)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--exe", required=True, help="all-double FerroX executable")
+    parser.add_argument("--exe-mp", required=True, help="MIXED_PRECISION=TRUE FerroX executable")
+    parser.add_argument("--mpi", default="", help='launcher prefix, e.g. "mpiexec -n 4"')
+    parser.add_argument("--deck", default="MIS")
+    parser.add_argument("--nsteps", type=int, default=5000)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--workdir", default="precision_runs")
+    parser.add_argument("--rtol", type=float, default=1.e-4, help="allowed relative difference")
+    parser.add_argument("--step-tol", type=int, default=2, help="allowed difference of the steps to steady state")
+    args = parser.parse_args()
+
+    rows_d, fp_d = run(args.exe, args.deck, "double", args)
+    rows_m, fp_m = run(args.exe_mp, args.deck, "mixed", args)
+
+    results = []
+    scale = {c: max(abs(r[c]) for r in rows_d) for c in LOOP_COLUMNS}
+
+    loop_d, loop_m = voltages(rows_d), voltages(rows_m)
+    n = min(len(loop_d), len(loop_m))
+    results.append(("loop", "voltages", len(loop_d), len(loop_m), 0., len(loop_d) == len(loop_m)))
+    for c in LOOP_COLUMNS:
+        diff = max([rel(gd[-1][c], gm[-1][c], scale[c]) for gd, gm in zip(loop_d[:n], loop_m[:n])] or [0.])
+        results.append(("loop", c + " converged", "", "", diff, diff <= args.rtol))
+    # the last voltage is cut by nsteps rather than converged
+    steps = max([abs(len(gd) - len(gm)) for gd, gm in zip(loop_d[:n-1], loop_m[:n-1])] or [0])
+    results.append(("steady state", "steps difference", "", steps, 0., steps <= args.step_tol))
+
+    # same step at the same voltage in both runs
+    by_step = {int(r["step"]): r for r in rows_m}
+    common = [(r, by_step[int(r["step"])]) for r in rows_d
+              if int(r["step"]) in by_step and by_step[int(r["step"])]["Phi_Bc_hi"] == r["Phi_Bc_hi"]]
+    for c in LOOP_COLUMNS:
+        diff = max([rel(rd[c], rm[c], scale[c]) for rd, rm in common] or [0.])
+        results.append(("transient", c, "", "", diff, diff <= args.rtol))
+
+    for key in sorted(fp_d):
+        diff = rel(fp_d[key], fp_m.get(key, float("inf")), abs(fp_d[key]))
+        results.append(("final", key, fp_d[key], fp_m.get(key, "missing"), diff, diff <= args.rtol))
+
+    failed = False
+    print("{:14s} {:22s} {:>24s} {:>24s} {:>10s}  status".format("check", "quantity", "double", "mixed", "rel diff"))
+    for check, name, a, b, diff, ok in results:
+        failed = failed or not ok
+        print("{:14s} {:22s} {:>24} {:>24} {:10.2e}  {}".format(check, name, a, b, diff, "PASS" if ok else "FAIL"))
+    print("\nRESULT: " + ("FAIL" if failed else "PASS"))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""End-to-end regression harness for the decks in Exec/regression_inputs.
+
+Each deck is run for a fixed number of steps with a fixed seed and without
+plotfiles or checkpoints. The harness collects
+  - physics fingerprints: norm0/norm1/norm2 of Px, Py, Pz and Phi at the end
+    of the run (the "Fingerprint" lines printed by FerroX)
+  - wall time per phase: the regions of the JSON performance report
+and compares them with <deck>/baseline.json. Physics must match to a relative
+tolerance. A phase fails if it is slower than its baseline by more than the
+timing tolerance. Phases shorter than --time-min seconds are too noisy and are
+not checked. Each deck is also run with compute_E_on_the_fly=1, whose
+fingerprints must match those of the run with stored E to the same tolerance
+(--skip-e-modes leaves this out).
+
+  python3 regression.py --exe3d ../main3d.gnu.MPI.OMP.ex --exe2d ../main2d.gnu.MPI.OMP.ex
+  python3 regression.py ... --update-baselines    # record new baselines
+
+Baselines are machine specific; record them on the machine that runs the checks.
+A deck without a baseline is reported as NO BASELINE and does not fail the run.
+"""
+
+import argparse
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+DECKS = ["2D_MFIM", "3D_MFIM", "MIS"]
+FINGERPRINT = re.compile(r"^Fingerprint (\S+) norm0 (\S+) norm1 (\S+) norm2 (\S+)")
+
+
+def find_inputs(deck_dir):
+    files = [f for f in sorted(os.listdir(deck_dir))
+             if os.path.isfile(os.path.join(deck_dir, f)) and f != "baseline.json"]
+    if len(files) != 1:
+        sys.exit("expected one inputs file in {}, found {}".format(deck_dir, files))
+    return os.path.join(deck_dir, files[0])
+
+
+def deck_dim(inputs):
+    with open(inputs) as f:
+        for line in f:
+            line = line.split("#")[0].strip()
+            if line.startswith("domain.n_cell"):
+                return len(line.split("=", 1)[1].split())
+    sys.exit("domain.n_cell not found in " + inputs)
+
+
+def run_deck(deck, args, extra=(), tag=""):
+    deck_dir = os.path.join(HERE, deck)
+    inputs = find_inputs(deck_dir)
+    exe = args.exe3d if deck_dim(inputs) == 3 else args.exe2d
+    if not exe:
+        sys.exit("no executable for {} (--exe{}d)".format(deck, deck_dim(inputs)))
+
+    run_dir = os.path.join(os.path.abspath(args.workdir), deck + tag)
+    os.makedirs(run_dir, exist_ok=True)
+
+    overrides = ["nsteps={}".format(args.nsteps),
+                 "random_seed={}".format(args.seed),
+                 "plot_int=-1",
+                 "chk_int=-1",
+                 "diag_int=-1",
+                 "perf_report_file=perf.json",
+                 "perf_report_int=-1"] + list(extra)
+    cmd = shlex.split(args.mpi) + [os.path.abspath(exe), inputs] + overrides
+    with open(os.path.join(run_dir, "stdout.txt"), "w") as log:
+        proc = subprocess.run(cmd, cwd=run_dir, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                              universal_newlines=True)
+        log.write(proc.stdout)
+    if proc.returncode != 0:
+        return None, "exit code {} (see {})".format(proc.returncode, os.path.join(run_dir, "stdout.txt"))
+
+    fingerprints = {}
+    for line in proc.stdout.splitlines():
+        m = FINGERPRINT.match(line.strip())
+        if m:
+            name = m.group(1)
+            for key, val in zip(("norm0", "norm1", "norm2"), m.groups()[1:]):
+                fingerprints["{}.{}".format(name, key)] = float(val)
+    if not fingerprints:
+        return None, "no Fingerprint lines in the output"
+
+    with open(os.path.join(run_dir, "perf.json")) as f:
+        perf = json.load(f)
+    phases = {"total": perf["wall_time"]}
+    for name, reg in perf["regions"].items():
+        phases[name] = reg["time_max"]
+
+    return {"nsteps": args.nsteps, "seed": args.seed, "ranks": perf["ranks"],
+            "fingerprints": fingerprints, "phases": phases}, None
+
+
+def compare_fingerprints(deck, check, result, reference, args, rows):
+    ok = True
+    for key, ref in sorted(reference["fingerprints"].items()):
+        val = result["fingerprints"].get(key)
+        if val is None:
+            rows.append((deck, check, key, "{:.10e}".format(ref), "missing", "FAIL"))
+            ok = False
+            continue
+        diff = abs(val - ref) / max(abs(ref), args.phys_atol)
+        status = "PASS" if diff <= args.phys_rtol else "FAIL"
+        ok = ok and status == "PASS"
+        rows.append((deck, check, key, "{:.10e}".format(ref), "{:.10e}".format(val),
+                     "{} ({:.1e})".format(status, diff)))
+    return ok
+
+
+def compare(deck, result, baseline, args, rows):
+    if baseline["nsteps"] != result["nsteps"] or baseline["seed"] != result["seed"]:
+        rows.append((deck, "setup", "nsteps/seed", "{}/{}".format(baseline["nsteps"], baseline["seed"]),
+                     "{}/{}".format(result["nsteps"], result["seed"]), "FAIL"))
+        return False
+
+    ok = compare_fingerprints(deck, "physics", result, baseline, args, rows)
+
+    for key, ref in sorted(baseline["phases"].items()):
+        val = result["phases"].get(key)
+        if val is None or ref < args.time_min:
+            continue
+        ratio = val / ref
+        status = "PASS" if ratio <= 1.0 + args.time_rtol else "SLOW"
+        ok = ok and status == "PASS"
+        rows.append((deck, "time", key, "{:.4f}".format(ref), "{:.4f}".format(val),
+                     "{} (x{:.2f})".format(status, ratio)))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--exe3d", help="3D FerroX executable")
+    parser.add_argument("--exe2d", help="2D FerroX executable")
+    parser.add_argument("--mpi", default="", help='launcher prefix, e.g. "mpiexec -n 4"')
+    parser.add_argument("--decks", nargs="+", default=DECKS)
+    parser.add_argument("--nsteps", type=int, default=3)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--workdir", default="regression_runs")
+    parser.add_argument("--phys-rtol", type=float, default=1.e-9, help="relative tolerance of the fingerprints")
+    parser.add_argument("--phys-atol", type=float, default=1.e-30, help="floor of the fingerprint scale")
+    parser.add_argument("--time-rtol", type=float, default=0.10, help="allowed slowdown per phase")
+    parser.add_argument("--time-min", type=float, default=0.05, help="phases shorter than this are not checked")
+    parser.add_argument("--update-baselines", action="store_true")
+    parser.add_argument("--skip-e-modes", action="store_true",
+                        help="do not compare against a run with compute_E_on_the_fly=1")
+    args = parser.parse_args()
+
+    rows = []
+    failed = False
+    no_baseline = []
+    for deck in args.decks:
+        result, error = run_deck(deck, args)
+        if error:
+            rows.append((deck, "run", "-", "-", "-", "FAIL: " + error))
+            failed = True
+            continue
+
+        # stored E and E from the potential stencil must give the same trajectory
+        if not args.skip_e_modes:
+            result_fly, error = run_deck(deck, args, ["compute_E_on_the_fly=1"], "_E_on_the_fly")
+            if error:
+                rows.append((deck, "E modes", "-", "-", "-", "FAIL: " + error))
+                failed = True
+            else:
+                failed = not compare_fingerprints(deck, "E modes", result_fly, result, args, rows) or failed
+
+        baseline_file = os.path.join(HERE, deck, "baseline.json")
+        if args.update_baselines:
+            with open(baseline_file, "w") as f:
+                json.dump(result, f, indent=2, sort_keys=True)
+            rows.append((deck, "baseline", "-", "-", "-", "written"))
+        elif not os.path.exists(baseline_file):
+            # not a failure: nothing to compare against until baselines are recorded on this machine
+            rows.append((deck, "baseline", "-", "-", "-", "NO BASELINE (run --update-baselines)"))
+            no_baseline.append(deck)
+        else:
+            with open(baseline_file) as f:
+                baseline = json.load(f)
+            if baseline["ranks"] != result["ranks"]:
+                rows.append((deck, "setup", "ranks", str(baseline["ranks"]), str(result["ranks"]),
+                             "WARN: timings not comparable"))
+            failed = not compare(deck, result, baseline, args, rows) or failed
+
+    header = ("deck", "check", "quantity", "baseline", "current", "status")
+    widths = [max(len(str(r[i])) for r in rows + [header]) for i in range(len(header))]
+    for r in [header] + rows:
+        print("  ".join(str(c).ljust(w) for c, w in zip(r, widths)))
+    if failed:
+        print("\nRESULT: FAIL")
+    elif no_baseline:
+        print("\nRESULT: NO BASELINE for {}; record it with --update-baselines".format(", ".join(no_baseline)))
+    else:
+        print("\nRESULT: PASS")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
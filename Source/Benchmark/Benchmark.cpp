@@ -0,0 +1,434 @@
+#include <AMReX_ParmParse.H>
+#include <AMReX_MLABecLaplacian.H>
+#include <AMReX_MLMG.H>
+#include <AMReX_MultiFab.H>
+#include "FerroX.H"
+#include "Solver/ElectrostaticSolver.H"
+#include "Solver/Initialization.H"
+#include "Solver/ChargeDensity.H"
+#include "Solver/TotalEnergyDensity.H"
+#include "Input/GeometryProperties/GeometryProperties.H"
+#include "Utils/eXstaticUtils/eXstaticUtil.H"
+#include "Utils/FerroXUtils/FerroXRandom.H"
+#include "Utils/FerroXUtils/FerroXUtil.H"
+
+#include <AMReX_OpenMP.H>
+
+#ifdef AMREX_USE_OMP
+#include <omp.h>
+#endif
+
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+
+using namespace amrex;
+using namespace FerroX;
+
+// Kernel benchmark of the solver hot paths (Exec/Benchmark, BENCHMARK = TRUE).
+//
+// The domain and material parameters come from the inputs file as for FerroX. The stack
+// is replaced by a synthetic one per bench.configs entry:
+//   MFIM : DE below 45% of the height, FE above
+//   MFIS : SC below 50%, DE up to 60%, FE above
+//   poly : MFIM with cubic grains of bench.grain_cells cells and random orientations
+// and every kernel is timed for each bench.box_sizes (max_grid_size) and bench.threads.
+// Effective bandwidth assumes every field is read or written once per cell; the roofline
+// fraction compares it with a MultiFab triad on the same layout. All fields are first touched
+// with the kernels' tiling and thread schedule, as in FerroX.
+//
+// Before the sweep a STREAM triad on plain arrays (bench.stream_mb MB per array and rank) is
+// run by all threads and then by the threads of each socket alone, each on arrays first touched
+// by those same threads, giving the memory bandwidth per socket that the kernels can expect.
+
+namespace {
+
+// mean wall time of one call, max over ranks; the first call is a warm-up
+template <class F>
+Real TimeKernel (int repeats, F&& f)
+{
+    f();
+    Gpu::streamSynchronize();
+    ParallelDescriptor::Barrier();
+    const Real strt = ParallelDescriptor::second();
+    for (int r = 0; r < repeats; ++r) f();
+    Gpu::streamSynchronize();
+    Real t = (ParallelDescriptor::second() - strt)/repeats;
+    ParallelDescriptor::ReduceRealMax(t);
+    return t;
+}
+
+// stack layout of a synthetic configuration, as fractions of the height
+void SetStack (const std::string& config,
+               const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_lo,
+               const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_hi)
+{
+    const Real H = prob_hi[zdir] - prob_lo[zdir];
+    auto layer = [&] (amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& lo,
+                      amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& hi, Real f0, Real f1) {
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+            lo[d] = prob_lo[d];
+            hi[d] = prob_hi[d];
+        }
+        lo[zdir] = prob_lo[zdir] + f0*H;
+        hi[zdir] = prob_lo[zdir] + f1*H;
+    };
+    auto outside = [&] (amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& lo,
+                        amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& hi) {
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+            lo[d] = prob_lo[d] - 1.0;
+            hi[d] = prob_lo[d] - 1.0;
+        }
+    };
+
+    outside(Channel_lo, Channel_hi);
+    if (config == "MFIS") {
+        layer(SC_lo, SC_hi, 0.0, 0.5);
+        layer(DE_lo, DE_hi, 0.5, 0.6);
+        layer(FE_lo, FE_hi, 0.6, 1.0);
+    } else {
+        outside(SC_lo, SC_hi);
+        layer(DE_lo, DE_hi, 0.0, 0.45);
+        layer(FE_lo, FE_hi, 0.45, 1.0);
+    }
+}
+
+// random orientation per cubic grain, from the counter-based generator
+void SetGrainAngles (StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
+                     int grain_cells)
+{
+    const std::uint64_t seed = random_seed;
+    for (MFIter mfi(angle_alpha, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const Array4<StaticReal>& a = angle_alpha.array(mfi);
+        const Array4<StaticReal>& b = angle_beta.array(mfi);
+        const Array4<StaticReal>& t = angle_theta.array(mfi);
+        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            Real r0, r1, r2;
+            FerroX_Random::CellUniform3(i/grain_cells, j/grain_cells, k/grain_cells, 2, seed, r0, r1, r2);
+            a(i,j,k) = 360.*r0;
+            b(i,j,k) = 180.*r1;
+            t(i,j,k) = 360.*r2;
+        });
+    }
+}
+
+// STREAM triad a = b + s*c over n doubles per rank. With socket >= 0 only the threads running
+// on that socket take part, on their own chunk, which they also first touch; with socket < 0 all
+// threads do. Returns the best-of-repeats bandwidth of this rank in GB/s (24 bytes per element,
+// as STREAM counts), 0 if none of its threads is on the socket.
+Real StreamTriad (Long n, int repeats, int socket)
+{
+    const int nthreads = OpenMP::get_max_threads();
+    Vector<int> takes_part(nthreads, 0);
+    // new[] leaves the pages untouched, so each one is placed by the thread that writes it first
+    std::unique_ptr<double[]> a(new double[n]), b(new double[n]), c(new double[n]);
+    Real best = std::numeric_limits<Real>::max();
+    int nparts = 0;
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel
+#endif
+    {
+        const int t = OpenMP::get_thread_num();
+        int cpu, my_socket, numa;
+        FerroX_Util::ThreadPlacement(cpu, my_socket, numa);
+        takes_part[t] = (socket < 0 || my_socket == socket) ? 1 : 0;
+#ifdef AMREX_USE_OMP
+#pragma omp barrier
+#endif
+        int rank = 0, count = 0;
+        for (int i = 0; i < nthreads; ++i) {
+            if (i < t) rank += takes_part[i];
+            count += takes_part[i];
+        }
+        const Long lo = n*rank/amrex::max(count,1);
+        const Long hi = takes_part[t] ? n*(rank+1)/count : lo;
+        for (Long i = lo; i < hi; ++i) {
+            a[i] = 0.;
+            b[i] = 1.;
+            c[i] = 2.;
+        }
+        for (int r = 0; r < repeats; ++r) {
+            Real strt = 0.;
+#ifdef AMREX_USE_OMP
+#pragma omp barrier
+#pragma omp master
+#endif
+            strt = ParallelDescriptor::second();
+            for (Long i = lo; i < hi; ++i) a[i] = b[i] + 3.*c[i];
+#ifdef AMREX_USE_OMP
+#pragma omp barrier
+#pragma omp master
+#endif
+            {
+                best = amrex::min(best, ParallelDescriptor::second() - strt);
+                nparts = count;
+            }
+        }
+    }
+    return (nparts > 0) ? 24.*n/best/1.e9 : 0.;
+}
+
+} // namespace
+
+int main (int argc, char* argv[])
+{
+    amrex::Initialize(argc,argv);
+    {
+#ifdef AMREX_USE_EB
+        amrex::Abort("The kernel benchmark is built without EB (USE_EB = FALSE)");
+#endif
+        c_FerroX rFerroX;
+        rFerroX.InitData();
+
+        auto& rGprop = rFerroX.get_GeometryProperties();
+        auto& geom = rGprop.geom;
+        auto& prob_lo = rGprop.prob_lo;
+        auto& prob_hi = rGprop.prob_hi;
+        auto& n_cell = rGprop.n_cell;
+
+        InitializeFerroXNamespace(prob_lo, prob_hi);
+
+        ParmParse pp("bench");
+        Vector<std::string> configs = {"MFIM", "MFIS", "poly"};
+        pp.queryarr("configs", configs);
+        Vector<int> box_sizes = {32, 64};
+        pp.queryarr("box_sizes", box_sizes);
+        Vector<int> threads = {1};
+#ifdef AMREX_USE_OMP
+        threads[0] = omp_get_max_threads();
+#endif
+        pp.queryarr("threads", threads);
+        int repeats = 10;
+        pp.query("repeats", repeats);
+        int mlmg_repeats = 1;
+        pp.query("mlmg_repeats", mlmg_repeats);
+        int grain_cells = 8;
+        pp.query("grain_cells", grain_cells);
+        std::string output = "benchmark.csv";
+        pp.query("output", output);
+        Real stream_mb = 128.;
+        pp.query("stream_mb", stream_mb);
+
+        std::array<std::array<amrex::LinOpBCType,AMREX_SPACEDIM>,2> LinOpBCType_2d;
+        bool all_homogeneous_boundaries = true;
+        bool some_functionbased_inhomogeneous_boundaries = false;
+        bool some_constant_inhomogeneous_boundaries = false;
+        SetPoissonBC(rFerroX, LinOpBCType_2d, all_homogeneous_boundaries,
+                     some_functionbased_inhomogeneous_boundaries, some_constant_inhomogeneous_boundaries);
+
+        // bytes per cell of each kernel with every field touched once
+        const Real R = sizeof(Real), S = sizeof(StaticReal), M = sizeof(MaskType);
+        const Real E_bytes = (compute_E_on_the_fly == 1) ? R : 3*R;
+        const Real bytes_tdgl = 3*R + E_bytes + S + 2*M + 3*S + 3*R;
+        const Real bytes_poisson_rhs = 3*R + R + M + 3*S + R;
+        const Real bytes_efromphi = R + 3*S + 3*R;
+        const Real bytes_rho = R + M + 3*R;
+        const Real bytes_permittivity = 2*M + R;
+        const Real bytes_triad = 3*R;
+
+        std::ofstream ofs;
+        if (ParallelDescriptor::IOProcessor()) {
+            ofs.open(output, std::ios::out | std::ios::trunc);
+            if (!ofs.good()) amrex::FileOpenFailed(output);
+            ofs << "config,dim,ranks,threads,box_size,kernel,cells,time_per_call,Mcells_per_s,GB_per_s,"
+                << "triad_GB_per_s,roofline_fraction,mlmg_vcycles\n";
+            ofs << std::setprecision(6) << std::scientific;
+        }
+        amrex::Print() << std::setprecision(4);
+
+        // per-socket memory bandwidth, summed over ranks; off with bench.stream_mb = 0
+        if (stream_mb > 0.) {
+            const Long n = static_cast<Long>(stream_mb*1048576./sizeof(double));
+            int nsockets = 0;
+#ifdef AMREX_USE_OMP
+#pragma omp parallel reduction(max:nsockets)
+#endif
+            {
+                int cpu, socket, numa;
+                FerroX_Util::ThreadPlacement(cpu, socket, numa);
+                nsockets = amrex::max(nsockets, socket+1);
+            }
+            ParallelDescriptor::ReduceIntMax(nsockets);
+
+            Real bw_all = StreamTriad(n, repeats, -1);
+            ParallelDescriptor::ReduceRealSum(bw_all);
+            auto report_stream = [&] (const std::string& kernel, Real bw) {
+                amrex::Print() << "stream  " << std::setw(22) << kernel << std::setw(10) << bw << " GB/s";
+                if (bw_all > 0.) amrex::Print() << " (" << 100.*bw/bw_all << "% of all threads)";
+                amrex::Print() << "\n";
+                if (ParallelDescriptor::IOProcessor()) {
+                    ofs << "stream," << AMREX_SPACEDIM << "," << ParallelDescriptor::NProcs() << ","
+                        << OpenMP::get_max_threads() << ",0," << kernel << "," << n*ParallelDescriptor::NProcs() << ","
+                        << ((bw > 0.) ? 24.*n*ParallelDescriptor::NProcs()/bw/1.e9 : 0.) << ",0," << bw << ","
+                        << bw_all << "," << ((bw_all > 0.) ? bw/bw_all : 0.) << ",0\n";
+                }
+            };
+            report_stream("STREAM_triad", bw_all);
+            for (int s = 0; s < nsockets; ++s) {
+                Real bw = StreamTriad(n, repeats, s);
+                ParallelDescriptor::ReduceRealSum(bw);
+                report_stream("STREAM_triad_socket" + std::to_string(s), bw);
+            }
+        }
+
+        const int use_Fermi_Dirac_input = use_Fermi_Dirac;
+
+        for (const auto& config : configs)
+        {
+            if (config != "MFIM" && config != "MFIS" && config != "poly") {
+                amrex::Abort("bench.configs: unknown configuration " + config);
+            }
+            SetStack(config, prob_lo, prob_hi);
+
+            for (int bs : box_sizes)
+            {
+                BoxArray ba(geom.Domain());
+                ba.maxSize(bs);
+                DistributionMapping dm(ba);
+                const Long ncells = ba.numPts();
+
+                // the production MLMG setup takes its layout from the geometry properties
+                rGprop.ba = ba;
+                rGprop.dm = dm;
+
+                Array<MultiFab, 3> P_old, GL_rhs, E;
+                for (int dir = 0; dir < 3; dir++) {
+                    P_old[dir].define(ba, dm, 1, 1);
+                    GL_rhs[dir].define(ba, dm, 1, 1);
+                    E[dir].define(ba, dm, 1, 0);
+                }
+                StaticMultiFab Gamma(ba, dm, 1, 1);
+                MultiFab PoissonRHS(ba, dm, 1, 0);
+                MultiFab PoissonPhi(ba, dm, 1, 1);
+                MultiFab rho(ba, dm, 1, 0);
+                MultiFab e_den(ba, dm, 1, 0);
+                MultiFab p_den(ba, dm, 1, 0);
+                MultiFab alpha_cc(ba, dm, 1, 0);
+                MultiFab beta_cc(ba, dm, 1, 1);
+                MaskMultiFab MaterialMask(ba, dm, 1, 1);
+                MaskMultiFab tphaseMask(ba, dm, 1, 1);
+                StaticMultiFab angle_alpha(ba, dm, 1, 0);
+                StaticMultiFab angle_beta(ba, dm, 1, 0);
+                StaticMultiFab angle_theta(ba, dm, 1, 0);
+                std::array< MultiFab, AMREX_SPACEDIM > beta_face;
+                AMREX_D_TERM(beta_face[0].define(convert(ba,IntVect(AMREX_D_DECL(1,0,0))), dm, 1, 0);,
+                             beta_face[1].define(convert(ba,IntVect(AMREX_D_DECL(0,1,0))), dm, 1, 0);,
+                             beta_face[2].define(convert(ba,IntVect(AMREX_D_DECL(0,0,1))), dm, 1, 0););
+
+                {
+                    using FerroX_Util::FirstTouch;
+                    for (int dir = 0; dir < 3; dir++) {
+                        FirstTouch(P_old[dir]);
+                        FirstTouch(GL_rhs[dir]);
+                        FirstTouch(E[dir]);
+                    }
+                    for (int dir = 0; dir < AMREX_SPACEDIM; dir++) FirstTouch(beta_face[dir]);
+                    FirstTouch(Gamma);
+                    FirstTouch(PoissonRHS);
+                    FirstTouch(PoissonPhi);
+                    FirstTouch(rho);
+                    FirstTouch(e_den);
+                    FirstTouch(p_den);
+                    FirstTouch(alpha_cc);
+                    FirstTouch(beta_cc);
+                    FirstTouch(MaterialMask);
+                    FirstTouch(tphaseMask);
+                    FirstTouch(angle_alpha);
+                    FirstTouch(angle_beta);
+                    FirstTouch(angle_theta);
+                }
+                if (config == "poly") SetGrainAngles(angle_alpha, angle_beta, angle_theta, grain_cells);
+
+                InitializeMaterialMask(MaterialMask, geom, prob_lo, prob_hi);
+                InitializePandRho(P_old, Gamma, rho, e_den, p_den, MaterialMask, tphaseMask, geom, prob_lo, prob_hi);
+                InitializePermittivity(LinOpBCType_2d, beta_cc, MaterialMask, tphaseMask, n_cell, geom, prob_lo, prob_hi);
+                eXstatic_MFab_Util::AverageCellCenteredMultiFabToCellFaces(beta_cc, beta_face);
+
+                Real time = 0.;
+                amrex::LPInfo info;
+                std::unique_ptr<amrex::MLMG> pMLMG;
+                std::unique_ptr<amrex::MLABecLaplacian> p_mlabec;
+                SetupMLMG(pMLMG, p_mlabec, LinOpBCType_2d, n_cell, beta_face, rFerroX, PoissonPhi, time, info);
+                p_mlabec->setACoeffs(0, alpha_cc);
+                ComputePoissonRHS(PoissonRHS, P_old, rho, MaterialMask, angle_alpha, angle_beta, angle_theta, geom);
+
+                for (int nt : threads)
+                {
+#ifdef AMREX_USE_OMP
+                    omp_set_num_threads(nt);
+#else
+                    nt = 1;
+#endif
+                    // bandwidth roof on this layout: a = b + s*c
+                    const Real t_triad = TimeKernel(repeats, [&] () {
+                        MultiFab::LinComb(GL_rhs[0], 1.0, P_old[0], 0, 0.5, P_old[1], 0, 0, 1, 0);
+                    });
+                    const Real triad_bw = bytes_triad*ncells/t_triad/1.e9;
+
+                    auto report = [&] (const std::string& kernel, Real t, Real bytes_per_cell, int vcycles) {
+                        const Real mcells = ncells/t/1.e6;
+                        const Real bw = bytes_per_cell*ncells/t/1.e9;
+                        amrex::Print() << std::setw(6) << config << " box " << std::setw(4) << bs
+                                       << " threads " << std::setw(3) << nt << "  " << std::setw(22) << kernel
+                                       << std::setw(12) << t << " s  " << std::setw(10) << mcells << " Mcells/s";
+                        if (bytes_per_cell > 0.) {
+                            amrex::Print() << std::setw(10) << bw << " GB/s (" << 100.*bw/triad_bw << "% of triad)";
+                        }
+                        amrex::Print() << "\n";
+                        if (ParallelDescriptor::IOProcessor()) {
+                            ofs << config << "," << AMREX_SPACEDIM << "," << ParallelDescriptor::NProcs() << ","
+                                << nt << "," << bs << "," << kernel << "," << ncells << "," << t << ","
+                                << mcells << "," << bw << "," << triad_bw << ","
+                                << ((bytes_per_cell > 0.) ? bw/triad_bw : 0.) << "," << vcycles << "\n";
+                        }
+                    };
+
+                    report("Triad", t_triad, bytes_triad, 0);
+
+                    report("CalculateTDGL_RHS", TimeKernel(repeats, [&] () {
+                        CalculateTDGL_RHS(GL_rhs, P_old, E, PoissonPhi, Gamma, MaterialMask, tphaseMask,
+                                          angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
+                    }), bytes_tdgl, 0);
+
+                    report("ComputePoissonRHS", TimeKernel(repeats, [&] () {
+                        ComputePoissonRHS(PoissonRHS, P_old, rho, MaterialMask, angle_alpha, angle_beta, angle_theta, geom);
+                    }), bytes_poisson_rhs, 0);
+
+                    report("ComputeEfromPhi", TimeKernel(repeats, [&] () {
+                        ComputeEfromPhi(PoissonPhi, E, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
+                    }), bytes_efromphi, 0);
+
+                    use_Fermi_Dirac = 0;
+                    report("ComputeRho_Boltzmann", TimeKernel(repeats, [&] () {
+                        ComputeRho(PoissonPhi, rho, e_den, p_den, MaterialMask);
+                    }), bytes_rho, 0);
+
+                    use_Fermi_Dirac = 1;
+                    report("ComputeRho_FermiDirac", TimeKernel(repeats, [&] () {
+                        ComputeRho(PoissonPhi, rho, e_den, p_den, MaterialMask);
+                    }), bytes_rho, 0);
+                    use_Fermi_Dirac = use_Fermi_Dirac_input;
+
+                    report("InitializePermittivity", TimeKernel(repeats, [&] () {
+                        InitializePermittivity(LinOpBCType_2d, beta_cc, MaterialMask, tphaseMask, n_cell, geom, prob_lo, prob_hi);
+                    }), bytes_permittivity, 0);
+
+                    ComputePoissonRHS(PoissonRHS, P_old, rho, MaterialMask, angle_alpha, angle_beta, angle_theta, geom);
+                    // time first: getNumIters() must see the last timed solve
+                    const Real t_mlmg = TimeKernel(mlmg_repeats, [&] () {
+                        PoissonPhi.setVal(0.);
+                        pMLMG->solve({&PoissonPhi}, {&PoissonRHS}, 1.e-10, -1);
+                    });
+                    report("MLMG_solve", t_mlmg, 0., pMLMG->getNumIters());
+                }
+            }
+        }
+    }
+    amrex::Finalize();
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "FerroX.H"
+#include "Utils/FerroXUtils/PerfCounters.H"
+#include <AMReX_ParmParse.H>
+#include <AMReX_PlotFileUtil.H>
+#include <AMReX_VisMF.H>
+#include <AMReX_FileSystem.H>
+
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+// Fields are written with VisMF (ghost cells included, native precision, vismf.noutfiles
+// files written in parallel); the scalar state goes into the text Header, which is written
+// last so that an interrupted checkpoint is never picked up for restart.
+
+static std::string CheckpointField (const std::string& chkfile, const std::string& name)
+{
+    return amrex::MultiFabFileFullPrefix(0, chkfile, "Level_", name);
+}
+
+// read the valid cells of a field and rebuild its halo; the checkpoint may have been
+// written with a different number of ghost cells (wide_halo) or distribution
+static void ReadCheckpointField (MultiFab& mf, const std::string& chkfile, const std::string& name,
+                                 const Geometry& geom)
+{
+    MultiFab mf_chk;
+    VisMF::Read(mf_chk, CheckpointField(chkfile, name));
+    mf.ParallelCopy(mf_chk, 0, 0, mf.nComp());
+    mf.FillBoundary(geom.periodicity());
+}
+
+void WriteCheckpoint(int step,
+                     Real time,
+                     int sign,
+                     int num_Vapp,
+                     int steady_state_step,
+                     Array< MultiFab, 3>& P_old,
+                     Array< MultiFab, 3>& E,
+                     MultiFab& PoissonPhi,
+                     MultiFab& PoissonPhi_Old,
+                    MultiFab& PoissonPhi_E,
+                     MultiFab& PoissonPhi_E,
+                     MultiFab& hole_den,
+                     MultiFab& e_den,
+                     MultiFab& charge_den)
+{
+    // timer for profiling
+    BL_PROFILE_VAR("WriteCheckpoint()",WriteCheckpoint);
+    FerroX_Perf::Region perf_region("WriteCheckpoint()");
+
+    const std::string& chkfile = amrex::Concatenate(chk_file, step, 8);
+
+    amrex::Print() << "Writing checkpoint " << chkfile << "\n";
+
+    amrex::PreBuildDirectorHierarchy(chkfile, "Level_", 1, true);
+
+    const char* P_names[3] = {"Px", "Py", "Pz"};
+    const char* E_names[3] = {"Ex", "Ey", "Ez"};
+    for (int dir = 0; dir < 3; dir++) {
+        VisMF::Write(P_old[dir], CheckpointField(chkfile, P_names[dir]));
+        // E is stored because the step after a voltage increment uses the field of the previous potential
+        if (E[dir].ok()) VisMF::Write(E[dir], CheckpointField(chkfile, E_names[dir]));
+    }
+    VisMF::Write(PoissonPhi, CheckpointField(chkfile, "Phi"));
+    if (PoissonPhi_Old.ok()) VisMF::Write(PoissonPhi_Old, CheckpointField(chkfile, "Phi_Old"));
+    // with compute_E_on_the_fly, the potential E is taken from plays the role of the stored E
+    if (PoissonPhi_E.ok()) VisMF::Write(PoissonPhi_E, CheckpointField(chkfile, "Phi_E"));
+    VisMF::Write(hole_den, CheckpointField(chkfile, "holes"));
+    VisMF::Write(e_den, CheckpointField(chkfile, "electrons"));
+    VisMF::Write(charge_den, CheckpointField(chkfile, "charge"));
+
+    ParallelDescriptor::Barrier();
+
+    if (ParallelDescriptor::IOProcessor()) {
+        std::ofstream HeaderFile(chkfile + "/Header");
+        if (!HeaderFile.good()) {
+            amrex::FileOpenFailed(chkfile + "/Header");
+        }
+        HeaderFile << std::setprecision(std::numeric_limits<Real>::max_digits10);
+        HeaderFile << "FerroX checkpoint\n"
+                   << "step " << step << "\n"
+                   << "time " << time << "\n"
+                   << "dt " << dt << "\n"
+                   << "Phi_Bc_hi " << Phi_Bc_hi << "\n"
+                   << "sign " << sign << "\n"
+                   << "num_Vapp " << num_Vapp << "\n"
+                   << "steady_state_step " << steady_state_step << "\n"
+                   << "inc_step " << inc_step << "\n"
+                   << "has_E " << (E[0].ok() ? 1 : 0) << "\n"
+                   << "has_Phi_Old " << (PoissonPhi_Old.ok() ? 1 : 0) << "\n"
+                   << "has_Phi_E " << (PoissonPhi_E.ok() ? 1 : 0) << "\n";
+    }
+
+    // rotation: keep only the newest chk_keep checkpoints written by this run
+    static std::deque<std::string> written;
+    written.push_back(chkfile);
+    while (chk_keep > 0 && static_cast<int>(written.size()) > chk_keep) {
+        if (ParallelDescriptor::IOProcessor()) {
+            amrex::FileSystem::RemoveAll(written.front());
+        }
+        written.pop_front();
+    }
+}
+
+bool ReadCheckpoint(const std::string& chkfile,
+                    int& step,
+                    Real& time,
+                    int& sign,
+                    int& num_Vapp,
+                    int& steady_state_step,
+                    Array< MultiFab, 3>& P_old,
+                    Array< MultiFab, 3>& E,
+                    MultiFab& PoissonPhi,
+                    MultiFab& PoissonPhi_Old,
+                    MultiFab& hole_den,
+                    MultiFab& e_den,
+                    MultiFab& charge_den,
+                    const Geometry& geom)
+{
+    // timer for profiling
+    BL_PROFILE_VAR("ReadCheckpoint()",ReadCheckpoint);
+
+    amrex::Print() << "Restarting from checkpoint " << chkfile << "\n";
+
+    Vector<char> fileCharPtr;
+    ParallelDescriptor::ReadAndBcastFile(chkfile + "/Header", fileCharPtr);
+    std::istringstream is(fileCharPtr.dataPtr(), std::istringstream::in);
+
+    std::string line, key;
+    std::getline(is, line);
+    if (line != "FerroX checkpoint") {
+        amrex::Abort("ReadCheckpoint: " + chkfile + " is not a FerroX checkpoint");
+    }
+
+    int has_E = 0;
+    int has_Phi_Old = 1;
+    int has_Phi_E = 0;
+    while (is >> key) {
+        if      (key == "step")              is >> step;
+        else if (key == "time")              is >> time;
+        else if (key == "dt")                is >> dt;
+        else if (key == "Phi_Bc_hi")         is >> Phi_Bc_hi;
+        else if (key == "sign")              is >> sign;
+        else if (key == "num_Vapp")          is >> num_Vapp;
+        else if (key == "steady_state_step") is >> steady_state_step;
+        else if (key == "inc_step")          is >> inc_step;
+        else if (key == "has_E")             is >> has_E;
+        else if (key == "has_Phi_Old")       is >> has_Phi_Old;
+        else if (key == "has_Phi_E")         is >> has_Phi_E;
+        else std::getline(is, line);
+    }
+
+    // P, E and Phi carry a halo whose width depends on wide_halo; their valid cells are read
+    // and the ghost cells inside the (periodic) domain rebuilt, so a run may restart with
+    // either setting. The caller resets the potential below and above the stack.
+    const char* P_names[3] = {"Px", "Py", "Pz"};
+    const char* E_names[3] = {"Ex", "Ey", "Ez"};
+    for (int dir = 0; dir < 3; dir++) {
+        ReadCheckpointField(P_old[dir], chkfile, P_names[dir], geom);
+        if (E[dir].ok() && has_E) {
+            ReadCheckpointField(E[dir], chkfile, E_names[dir], geom);
+        }
+    }
+    ReadCheckpointField(PoissonPhi, chkfile, "Phi", geom);
+    // a checkpoint of an energy-criterion run has no Phi_Old; the restored potential is the previous step's
+    if (PoissonPhi_Old.ok()) {
+        if (has_Phi_Old) {
+            VisMF::Read(PoissonPhi_Old, CheckpointField(chkfile, "Phi_Old"));
+        } else {
+            MultiFab::Copy(PoissonPhi_Old, PoissonPhi, 0, 0, 1, 0);
+        }
+    }
+    // its contact ghost cells belong to the potential of its step (before a voltage increment),
+    // so they are copied along with the valid cells
+    if (PoissonPhi_E.ok() && has_Phi_E) {
+        MultiFab mf_chk;
+        VisMF::Read(mf_chk, CheckpointField(chkfile, "Phi_E"));
+        const IntVect ng = amrex::min(mf_chk.nGrowVect(), PoissonPhi_E.nGrowVect());
+        PoissonPhi_E.ParallelCopy(mf_chk, 0, 0, 1, ng, ng, geom.periodicity());
+        PoissonPhi_E.FillBoundary(geom.periodicity());
+    }
+    VisMF::Read(hole_den, CheckpointField(chkfile, "holes"));
+    VisMF::Read(e_den, CheckpointField(chkfile, "electrons"));
+    VisMF::Read(charge_den, CheckpointField(chkfile, "charge"));
+
+    amrex::Print() << "Restart at step " << step << ", time = " << time
+                   << ", Phi_Bc_hi = " << Phi_Bc_hi << "\n";
+
+    // false if the caller has to rebuild E (or the potential E is taken from) from the potential
+    return (E[0].ok() && has_E) || (PoissonPhi_E.ok() && has_Phi_E);
+}
@@ -0,0 +1,187 @@
+#include "FreeEnergy.H"
+#include "DerivativeAlgorithm.H"
+#include "TotalEnergyDensity.H"
+#include "Utils/FerroXUtils/PerfCounters.H"
+
+#include <limits>
+
+namespace {
+
+// reference of the previous energy check
+bool have_ref = false;
+int ref_step = 0;
+Real ref_energy = 0.;
+Real ref_V = 0.;
+
+} // namespace
+
+FreeEnergy ComputeFreeEnergy (Array<MultiFab, 3>& P_old,
+                              Array<MultiFab, 3>& GL_rhs,
+                              MultiFab& PoissonPhi,
+                              MultiFab& beta_cc,
+                              MaskMultiFab& MaterialMask,
+                              StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
+                              const Geometry& geom)
+{
+    FERROX_PROFILE("ComputeFreeEnergy()");
+
+    const auto dx = geom.CellSizeArray();
+    const auto prob_lo = geom.ProbLoArray();
+    const auto prob_hi = geom.ProbHiArray();
+
+    Real dV = 1.;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) dV *= dx[d];
+
+    ReduceOps<ReduceOpSum, ReduceOpSum, ReduceOpSum, ReduceOpMax> reduce_op;
+    ReduceData<Real, Real, Real, Real> reduce_data(reduce_op);
+    using ReduceTuple = typename decltype(reduce_data)::Type;
+
+    for (MFIter mfi(PoissonPhi, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+
+        const Array4<Real>& pOld_p = P_old[0].array(mfi);
+        const Array4<Real>& pOld_q = P_old[1].array(mfi);
+        const Array4<Real>& pOld_r = P_old[2].array(mfi);
+        const Array4<Real const>& rhs_p = GL_rhs[0].const_array(mfi);
+        const Array4<Real const>& rhs_q = GL_rhs[1].const_array(mfi);
+        const Array4<Real const>& rhs_r = GL_rhs[2].const_array(mfi);
+        const Array4<Real>& phi = PoissonPhi.array(mfi);
+        const Array4<Real const>& eps = beta_cc.const_array(mfi);
+        const Array4<MaskType const>& mask = MaterialMask.const_array(mfi);
+        const Array4<StaticReal const>& angle_alpha_arr = angle_alpha.const_array(mfi);
+        const Array4<StaticReal const>& angle_beta_arr = angle_beta.const_array(mfi);
+        const Array4<StaticReal const>& angle_theta_arr = angle_theta.const_array(mfi);
+
+        reduce_op.eval(bx, reduce_data,
+        [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
+        {
+            const auto grad_phi = GradPhi(phi, i, j, k, dx, prob_lo, prob_hi);
+            const Real Ex = -grad_phi[0];
+            const Real Ey = -grad_phi[1];
+            const Real Ez = -grad_phi[2];
+
+            Real f_landau = 0.;
+            Real f_grad = 0.;
+            Real EdotP = 0.;
+
+            if (mask(i,j,k) == FE) {
+                const Real Pp = pOld_p(i,j,k);
+                const Real Pq = pOld_q(i,j,k);
+                const Real Pr = pOld_r(i,j,k);
+                f_landau = F_Landau(Pp, Pq, Pr);
+
+                const Real dpdx = DPDx(pOld_p, mask, i, j, k, dx);
+                const Real dpdy = DPDy(pOld_p, mask, i, j, k, dx);
+                const Real dpdz = DPDz(pOld_p, mask, i, j, k, dx);
+                const Real dqdx = DPDx(pOld_q, mask, i, j, k, dx);
+                const Real dqdy = DPDy(pOld_q, mask, i, j, k, dx);
+                const Real dqdz = DPDz(pOld_q, mask, i, j, k, dx);
+                const Real drdx = DPDx(pOld_r, mask, i, j, k, dx);
+                const Real drdy = DPDy(pOld_r, mask, i, j, k, dx);
+                const Real drdz = DPDz(pOld_r, mask, i, j, k, dx);
+                f_grad = 0.5*g11*(dpdx*dpdx + dqdy*dqdy + drdz*drdz)
+                       + 0.5*g44*(dpdy*dpdy + dpdz*dpdz + dqdx*dqdx + dqdz*dqdz + drdx*drdx + drdy*drdy)
+                       + g12*(dpdx*dqdy + dqdy*drdz + dpdx*drdz);
+
+                // crystal-to-lab rotation, as in ComputePoissonRHS
+                const Real Pi = 3.14159265358979323846;
+                const Real alpha_rad = Pi/180.*angle_alpha_arr(i,j,k);
+                const Real beta_rad  = Pi/180.*angle_beta_arr(i,j,k);
+                const Real theta_rad = Pi/180.*angle_theta_arr(i,j,k);
+                Real R_11, R_12, R_13, R_21, R_22, R_23, R_31, R_32, R_33;
+                if (use_Euler_angles) {
+                    R_11 = cos(alpha_rad)*cos(theta_rad) - cos(beta_rad)*sin(alpha_rad)*sin(theta_rad);
+                    R_12 = sin(alpha_rad)*cos(theta_rad) + cos(beta_rad)*cos(alpha_rad)*sin(theta_rad);
+                    R_13 = sin(beta_rad)*sin(theta_rad);
+                    R_21 = -cos(beta_rad)*cos(theta_rad)*sin(alpha_rad) - cos(alpha_rad)*sin(theta_rad);
+                    R_22 = cos(beta_rad)*cos(alpha_rad)*cos(theta_rad) - sin(alpha_rad)*sin(theta_rad);
+                    R_23 = sin(beta_rad)*cos(theta_rad);
+                    R_31 = sin(alpha_rad)*sin(beta_rad);
+                    R_32 = -cos(alpha_rad)*sin(beta_rad);
+                    R_33 = cos(beta_rad);
+                } else {
+                    R_11 = cos(beta_rad)*cos(theta_rad);
+                    R_12 = sin(alpha_rad)*sin(beta_rad)*cos(theta_rad) - cos(alpha_rad)*sin(theta_rad);
+                    R_13 = cos(alpha_rad)*sin(beta_rad)*cos(theta_rad) + sin(alpha_rad)*sin(theta_rad);
+                    R_21 = cos(beta_rad)*sin(theta_rad);
+                    R_22 = sin(beta_rad)*sin(alpha_rad)*sin(theta_rad) + cos(alpha_rad)*cos(theta_rad);
+                    R_23 = cos(alpha_rad)*sin(beta_rad)*sin(theta_rad) - sin(alpha_rad)*cos(theta_rad);
+                    R_31 = -sin(beta_rad);
+                    R_32 = sin(alpha_rad)*cos(beta_rad);
+                    R_33 = cos(alpha_rad)*cos(beta_rad);
+                }
+                EdotP = Ex*(R_11*Pp + R_21*Pq + R_31*Pr)
+                      + Ey*(R_12*Pp + R_22*Pq + R_32*Pr)
+                      + Ez*(R_13*Pp + R_23*Pq + R_33*Pr);
+            }
+
+            const Real f_elec = -EdotP - 0.5*eps(i,j,k)*(Ex*Ex + Ey*Ey + Ez*Ez);
+
+            const Real rate = amrex::max(amrex::Math::abs(rhs_p(i,j,k)),
+                                         amrex::Math::abs(rhs_q(i,j,k)),
+                                         amrex::Math::abs(rhs_r(i,j,k)));
+
+            return {f_landau*dV, f_grad*dV, f_elec*dV, rate};
+        });
+    }
+
+    auto hv = reduce_data.value(reduce_op);
+    Real sums[3] = {amrex::get<0>(hv), amrex::get<1>(hv), amrex::get<2>(hv)};
+    Real max_rate = amrex::get<3>(hv);
+    ParallelDescriptor::ReduceRealSum(sums, 3);
+    ParallelDescriptor::ReduceRealMax(max_rate);
+
+    FreeEnergy F;
+    F.landau = sums[0];
+    F.gradient = sums[1];
+    F.electrostatic = sums[2];
+    F.max_dP = dt*max_rate;
+    return F;
+}
+
+void CheckSteadyStateEnergy (Array<MultiFab, 3>& P_old,
+                             Array<MultiFab, 3>& GL_rhs,
+                             MultiFab& PoissonPhi,
+                             MultiFab& beta_cc,
+                             MaskMultiFab& MaterialMask,
+                             StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
+                             const Geometry& geom,
+                             int step, int& steady_state_step, int& inc_step)
+{
+    if (step % steady_state_int != 0) return;
+
+    const FreeEnergy F = ComputeFreeEnergy(P_old, GL_rhs, PoissonPhi, beta_cc, MaterialMask,
+                                           angle_alpha, angle_beta, angle_theta, geom);
+    const Real F_tot = F.total();
+
+    // a new applied voltage starts a new relaxation
+    if (have_ref && Phi_Bc_hi != ref_V) have_ref = false;
+
+    if (have_ref && step > ref_step) {
+        const Real scale = amrex::max(amrex::Math::abs(F_tot), std::numeric_limits<Real>::min());
+        const Real rel_rate = amrex::Math::abs(F_tot - ref_energy)/scale/(step - ref_step);
+
+        if (step > 1 && rel_rate < energy_rate_tolerance && F.max_dP < P_change_tolerance) {
+            steady_state_step = step;
+            inc_step = step;
+        }
+
+        if (log_verbosity >= 1) {
+            amrex::Print() << "Steady state check : |dF/F| per step = " << rel_rate
+                           << ", max |dP| = " << F.max_dP << std::endl;
+        }
+    } else if (log_verbosity >= 1) {
+        amrex::Print() << "Steady state check : reference energy recorded, max |dP| = " << F.max_dP << std::endl;
+    }
+
+    if (log_verbosity >= 1) {
+        amrex::Print() << "Free energy : Landau = " << F.landau << ", gradient = " << F.gradient
+                       << ", electrostatic = " << F.electrostatic << ", total = " << F_tot << std::endl;
+    }
+
+    have_ref = true;
+    ref_step = step;
+    ref_energy = F_tot;
+    ref_V = Phi_Bc_hi;
+}
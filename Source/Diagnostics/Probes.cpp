@@ -0,0 +1,259 @@
+#include "Probes.H"
+#include "Utils/SelectWarpXUtils/WarpXUtil.H"
+#include "Utils/FerroXUtils/PerfCounters.H"
+
+#include <AMReX_ParmParse.H>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+
+void FerroXProbes::Init (const Geometry& geom, const BoxArray& ba, const DistributionMapping& dm)
+{
+    ParmParse pp("probes");
+    Vector<std::string> names;
+    if (!pp.queryarr("names", names)) return;
+
+    m_geom = geom;
+    pp.query("int", m_sample_int);
+    pp.query("flush_int", m_flush_int);
+    m_sample_int = amrex::max(m_sample_int, 1);
+    m_flush_int = amrex::max(m_flush_int, 1);
+
+    const auto& real_box = geom.ProbDomain();
+
+    for (int p = 0; p < names.size(); ++p) {
+        ParmParse ppn("probes." + names[p]);
+        std::string type = "point";
+        ppn.query("type", type);
+
+        Vector<Array<Real, 3>> pts;
+        auto read_pos = [&] (const char* key) {
+            Vector<Real> v;
+            ppn.getarr(key, v);
+            Array<Real, 3> x = {0., 0., 0.};
+            for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+                if (v[d] < real_box.lo(d) || v[d] > real_box.hi(d)) {
+                    amrex::Abort("probes." + names[p] + " lies outside the domain");
+                }
+                x[d] = v[d];
+            }
+            return x;
+        };
+
+        if (type == "point") {
+            pts.push_back(read_pos("x"));
+        } else if (type == "line") {
+            const auto x0 = read_pos("x0");
+            const auto x1 = read_pos("x1");
+            int npts = 2;
+            ppn.query("npts", npts);
+            npts = amrex::max(npts, 2);
+            for (int n = 0; n < npts; ++n) {
+                const Real s = static_cast<Real>(n)/(npts-1);
+                pts.push_back({x0[0] + s*(x1[0]-x0[0]), x0[1] + s*(x1[1]-x0[1]), x0[2] + s*(x1[2]-x0[2])});
+            }
+        } else {
+            amrex::Abort("probes." + names[p] + ".type must be point or line");
+        }
+
+        for (int n = 0; n < pts.size(); ++n) {
+            m_probe_of_point.push_back(p);
+            m_index_in_probe.push_back(n);
+            m_point_pos.push_back(pts[n]);
+        }
+    }
+    m_probe_names = names;
+    m_npoints = m_point_pos.size();
+
+    Vector<Real> pos(3*m_npoints);
+    for (int n = 0; n < m_npoints; ++n) {
+        for (int d = 0; d < 3; ++d) pos[3*n+d] = m_point_pos[n][d];
+    }
+    m_pos_dev.resize(pos.size());
+    Gpu::copy(Gpu::hostToDevice, pos.begin(), pos.end(), m_pos_dev.begin());
+
+    // each point belongs to the box containing its cell
+    const auto dx = geom.CellSizeArray();
+    const auto prob_lo = geom.ProbLoArray();
+    const Box& domain = geom.Domain();
+
+    int nlocal = 0;
+    for (MFIter mfi(ba, dm); mfi.isValid(); ++mfi) ++nlocal;
+    m_box_points.resize(nlocal);
+    m_box_values.resize(nlocal);
+
+    for (MFIter mfi(ba, dm); mfi.isValid(); ++mfi) {
+        const Box& bx = mfi.validbox();
+        Vector<int> owned;
+        for (int n = 0; n < m_npoints; ++n) {
+            IntVect iv;
+            for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+                iv[d] = static_cast<int>(std::floor((m_point_pos[n][d] - prob_lo[d])/dx[d]));
+                iv[d] = amrex::max(domain.smallEnd(d), amrex::min(domain.bigEnd(d), iv[d]));
+            }
+            if (bx.contains(iv)) owned.push_back(n);
+        }
+        const int li = mfi.LocalIndex();
+        m_box_points[li].resize(owned.size());
+        Gpu::copy(Gpu::hostToDevice, owned.begin(), owned.end(), m_box_points[li].begin());
+        m_box_values[li].resize(owned.size()*nfields);
+        m_nlocal += owned.size();
+    }
+
+    m_buffer.reserve(static_cast<std::size_t>(m_flush_int)*m_nlocal*record_size);
+
+    amrex::Print() << "Probes: " << m_probe_names.size() << " probes with " << m_npoints
+                   << " points, sampled every " << m_sample_int << " steps\n";
+}
+
+void FerroXProbes::Sample (int step, Real time, MultiFab& PoissonPhi, Array<MultiFab, 3>& P_old)
+{
+    if (!enabled() || step % m_sample_int != 0) return;
+
+    FERROX_PROFILE("FerroXProbes::Sample()");
+
+    const auto dx = m_geom.CellSizeArray();
+    const auto prob_lo = m_geom.ProbLoArray();
+    const Box& domain = m_geom.Domain();
+    const IntVect dom_lo = domain.smallEnd();
+    const IntVect dom_hi = domain.bigEnd();
+    const Real* pos = m_pos_dev.data();
+
+    for (MFIter mfi(PoissonPhi); mfi.isValid(); ++mfi)
+    {
+        const int li = mfi.LocalIndex();
+        const int npts = m_box_points[li].size();
+        if (npts == 0) continue;
+
+        const int* pts = m_box_points[li].data();
+        Real* out = m_box_values[li].data();
+
+        amrex::GpuArray<Array4<Real const>, nfields> f = {PoissonPhi.const_array(mfi),
+                                                          P_old[0].const_array(mfi),
+                                                          P_old[1].const_array(mfi),
+                                                          P_old[2].const_array(mfi)};
+
+        amrex::ParallelFor(npts, [=] AMREX_GPU_DEVICE (int m) noexcept
+        {
+            const int p = pts[m];
+            // lower corner of the interpolation stencil and the cell centres around the point,
+            // clamped to the first/last cell centre so that only interior data are used
+            int lo[3] = {0, 0, 0};
+            Real xc0[3] = {0., 0., 0.}, xc1[3] = {1., 1., 1.}, x[3] = {0., 0., 0.};
+            for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+                const Real xmin = prob_lo[d] + (dom_lo[d]+0.5)*dx[d];
+                const Real xmax = prob_lo[d] + (dom_hi[d]+0.5)*dx[d];
+                x[d] = amrex::max(xmin, amrex::min(xmax, pos[3*p+d]));
+                lo[d] = static_cast<int>(std::floor((x[d] - prob_lo[d])/dx[d] - 0.5));
+                lo[d] = amrex::max(dom_lo[d], amrex::min(amrex::max(dom_hi[d]-1, dom_lo[d]), lo[d]));
+                xc0[d] = prob_lo[d] + (lo[d]+0.5)*dx[d];
+                xc1[d] = xc0[d] + dx[d];
+            }
+            for (int n = 0; n < nfields; ++n) {
+                auto const& a = f[n];
+#if (AMREX_SPACEDIM == 3)
+                const int i = lo[0], j = lo[1], k = lo[2];
+                out[m*nfields+n] = trilinear_interp(xc0[0], xc1[0], xc0[1], xc1[1], xc0[2], xc1[2],
+                                                    a(i,j,k),   a(i,j,k+1),   a(i,j+1,k),   a(i,j+1,k+1),
+                                                    a(i+1,j,k), a(i+1,j,k+1), a(i+1,j+1,k), a(i+1,j+1,k+1),
+                                                    x[0], x[1], x[2]);
+#else
+                const int i = lo[0], j = lo[1];
+                out[m*nfields+n] = bilinear_interp(xc0[0], xc1[0], xc0[1], xc1[1],
+                                                   a(i,j,0), a(i,j+1,0), a(i+1,j,0), a(i+1,j+1,0),
+                                                   x[0], x[1]);
+#endif
+            }
+        });
+    }
+    Gpu::streamSynchronize();
+
+    // rank-local buffering, no communication
+    Vector<int> h_pts;
+    Vector<Real> h_vals;
+    for (MFIter mfi(PoissonPhi); mfi.isValid(); ++mfi)
+    {
+        const int li = mfi.LocalIndex();
+        const int npts = m_box_points[li].size();
+        if (npts == 0) continue;
+
+        h_pts.resize(npts);
+        h_vals.resize(npts*nfields);
+        Gpu::copy(Gpu::deviceToHost, m_box_points[li].begin(), m_box_points[li].end(), h_pts.begin());
+        Gpu::copy(Gpu::deviceToHost, m_box_values[li].begin(), m_box_values[li].end(), h_vals.begin());
+
+        for (int m = 0; m < npts; ++m) {
+            m_buffer.push_back(step);
+            m_buffer.push_back(time);
+            m_buffer.push_back(Phi_Bc_hi);
+            m_buffer.push_back(h_pts[m]);
+            for (int n = 0; n < nfields; ++n) m_buffer.push_back(h_vals[m*nfields+n]);
+        }
+    }
+
+    if (++m_nsamples >= m_flush_int) Flush();
+}
+
+void FerroXProbes::Flush ()
+{
+    if (!enabled()) return;
+
+    FERROX_PROFILE("FerroXProbes::Flush()");
+
+    const int IOProc = ParallelDescriptor::IOProcessorNumber();
+    const int nprocs = ParallelDescriptor::NProcs();
+
+    int nsend = m_buffer.size();
+    std::vector<int> counts(nprocs, 0);
+    ParallelDescriptor::Gather(&nsend, 1, counts.data(), 1, IOProc);
+
+    std::vector<int> disp(nprocs, 0);
+    for (int r = 1; r < nprocs; ++r) disp[r] = disp[r-1] + counts[r-1];
+    Vector<Real> all;
+    if (ParallelDescriptor::IOProcessor()) all.resize(disp[nprocs-1] + counts[nprocs-1]);
+    ParallelDescriptor::Gatherv(m_buffer.data(), nsend, all.data(), counts, disp, IOProc);
+
+    m_buffer.clear();
+    m_nsamples = 0;
+
+    if (ParallelDescriptor::IOProcessor())
+    {
+        const int nrec = all.size()/record_size;
+        Vector<int> order(nrec);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&] (int a, int b) {
+            const Real* ra = &all[a*record_size];
+            const Real* rb = &all[b*record_size];
+            return (ra[0] < rb[0]) || (ra[0] == rb[0] && ra[3] < rb[3]);
+        });
+
+        // a fresh run starts new files, a restarted run appends
+        Vector<std::ofstream> files(m_probe_names.size());
+        for (int p = 0; p < m_probe_names.size(); ++p) {
+            const std::string fname = "probe_" + m_probe_names[p] + ".csv";
+            if (m_first_flush && restart_file.empty()) {
+                files[p].open(fname, std::ios::out | std::ios::trunc);
+                files[p] << "step,time,Phi_Bc_hi,point,x,y,z,Phi,Px,Py,Pz\n";
+            } else {
+                files[p].open(fname, std::ios::out | std::ios::app);
+            }
+            if (!files[p].good()) amrex::FileOpenFailed(fname);
+            files[p] << std::setprecision(10) << std::scientific;
+        }
+
+        for (int r : order) {
+            const Real* rec = &all[r*record_size];
+            const int pt = static_cast<int>(rec[3]);
+            auto& ofs = files[m_probe_of_point[pt]];
+            ofs << static_cast<int>(rec[0]) << "," << rec[1] << "," << rec[2] << ","
+                << m_index_in_probe[pt] << ","
+                << m_point_pos[pt][0] << "," << m_point_pos[pt][1] << "," << m_point_pos[pt][2];
+            for (int n = 0; n < nfields; ++n) ofs << "," << rec[4+n];
+            ofs << "\n";
+        }
+    }
+    m_first_flush = false;
+}
@@ -0,0 +1,213 @@
+#include "ReducedDiagnostics.H"
+#include "DerivativeAlgorithm.H"
+#include "TotalEnergyDensity.H"
+#include "Utils/FerroXUtils/PerfCounters.H"
+
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// accumulated quantities, in the order of the reduction tuple
+enum DiagIndex : int {
+    N_FE = 0, SUM_PP, SUM_PQ, SUM_PR,
+    Q_SC, D_BOT, D_TOP,
+    N_DE, N_SC,
+    EX_FE, EY_FE, EZ_FE,
+    EX_DE, EY_DE, EZ_DE,
+    EX_SC, EY_SC, EZ_SC,
+    F_LANDAU, F_ELEC,
+    NDIAG
+};
+
+// ReduceOps/ReduceData with NDIAG sums, so every quantity comes from one pass
+template <typename T, std::size_t> using Repeat = T;
+
+template <typename Seq> struct SumReduce;
+
+template <std::size_t... I>
+struct SumReduce<std::index_sequence<I...>>
+{
+    using Ops  = ReduceOps<Repeat<ReduceOpSum, I>...>;
+    using Data = ReduceData<Repeat<Real, I>...>;
+    using Type = typename Data::Type;
+
+    AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+    static Type ToTuple (amrex::GpuArray<Real, NDIAG> const& v) noexcept { return Type{v[I]...}; }
+
+    static void ToArray (Type const& t, Real* out) { ((out[I] = amrex::get<I>(t)), ...); }
+};
+
+using DiagReduce = SumReduce<std::make_index_sequence<NDIAG>>;
+
+// values of the previous row, for the displacement current and capacitance
+bool have_prev = false;
+Real prev_time = 0.;
+Real prev_Q_top = 0.;
+Real prev_V = 0.;
+
+} // namespace
+
+void WriteReducedDiagnostics (int step, Real time,
+                              Array<MultiFab, 3>& P_old,
+                              MultiFab& PoissonPhi,
+                              MultiFab& charge_den,
+                              MultiFab& beta_cc,
+                              MaskMultiFab& MaterialMask,
+                              StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
+                              const Geometry& geom)
+{
+    FERROX_PROFILE("WriteReducedDiagnostics()");
+
+    const auto dx = geom.CellSizeArray();
+    const auto prob_lo = geom.ProbLoArray();
+    const auto prob_hi = geom.ProbHiArray();
+    const int z_lo = geom.Domain().smallEnd(zdir);
+    const int z_hi = geom.Domain().bigEnd(zdir);
+
+    Real dV = 1.;
+    Real area = 1.;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        dV *= dx[d];
+        if (d != zdir) area *= geom.ProbLength(d);
+    }
+    const Real dA = dV/dx[zdir];
+
+    DiagReduce::Ops reduce_op;
+    DiagReduce::Data reduce_data(reduce_op);
+
+    for (MFIter mfi(PoissonPhi, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+
+        const Array4<Real>& pOld_p = P_old[0].array(mfi);
+        const Array4<Real>& pOld_q = P_old[1].array(mfi);
+        const Array4<Real>& pOld_r = P_old[2].array(mfi);
+        const Array4<Real>& phi = PoissonPhi.array(mfi);
+        const Array4<Real const>& rho = charge_den.const_array(mfi);
+        const Array4<Real const>& eps = beta_cc.const_array(mfi);
+        const Array4<MaskType const>& mask = MaterialMask.const_array(mfi);
+        const Array4<StaticReal const>& angle_alpha_arr = angle_alpha.const_array(mfi);
+        const Array4<StaticReal const>& angle_beta_arr = angle_beta.const_array(mfi);
+        const Array4<StaticReal const>& angle_theta_arr = angle_theta.const_array(mfi);
+
+        reduce_op.eval(bx, reduce_data,
+        [=] AMREX_GPU_DEVICE (int i, int j, int k) -> DiagReduce::Type
+        {
+            amrex::GpuArray<Real, NDIAG> v;
+            for (int n = 0; n < NDIAG; ++n) v[n] = 0.;
+
+            // lab-frame E from the potential, including the one-sided metal-contact stencil
+            const auto grad_phi = GradPhi(phi, i, j, k, dx, prob_lo, prob_hi);
+            const Real Ex = -grad_phi[0];
+            const Real Ey = -grad_phi[1];
+            const Real Ez = -grad_phi[2];
+
+            Real Pz_lab = 0.;
+            const int m = mask(i,j,k);
+
+            if (m == FE) {
+                const Real Pp = pOld_p(i,j,k);
+                const Real Pq = pOld_q(i,j,k);
+                const Real Pr = pOld_r(i,j,k);
+                v[N_FE] = 1.;
+                v[SUM_PP] = Pp;
+                v[SUM_PQ] = Pq;
+                v[SUM_PR] = Pr;
+                v[EX_FE] = Ex;
+                v[EY_FE] = Ey;
+                v[EZ_FE] = Ez;
+                v[F_LANDAU] = F_Landau(Pp, Pq, Pr)*dV;
+
+                // third column of the crystal-to-lab rotation, as in ComputePoissonRHS
+                const Real Pi = 3.14159265358979323846;
+                const Real alpha_rad = Pi/180.*angle_alpha_arr(i,j,k);
+                const Real beta_rad  = Pi/180.*angle_beta_arr(i,j,k);
+                const Real theta_rad = Pi/180.*angle_theta_arr(i,j,k);
+                Real R_13, R_23, R_33;
+                if (use_Euler_angles) {
+                    R_13 = sin(beta_rad)*sin(theta_rad);
+                    R_23 = sin(beta_rad)*cos(theta_rad);
+                    R_33 = cos(beta_rad);
+                } else {
+                    R_13 = cos(alpha_rad)*sin(beta_rad)*cos(theta_rad) + sin(alpha_rad)*sin(theta_rad);
+                    R_23 = cos(alpha_rad)*sin(beta_rad)*sin(theta_rad) - sin(alpha_rad)*cos(theta_rad);
+                    R_33 = cos(alpha_rad)*cos(beta_rad);
+                }
+                Pz_lab = R_13*Pp + R_23*Pq + R_33*Pr;
+            } else if (m == DE) {
+                v[N_DE] = 1.;
+                v[EX_DE] = Ex;
+                v[EY_DE] = Ey;
+                v[EZ_DE] = Ez;
+            } else if (m >= SC) {
+                v[N_SC] = 1.;
+                v[EX_SC] = Ex;
+                v[EY_SC] = Ey;
+                v[EZ_SC] = Ez;
+                v[Q_SC] = rho(i,j,k)*dV;
+            }
+
+            v[F_ELEC] = 0.5*eps(i,j,k)*(Ex*Ex + Ey*Ey + Ez*Ez)*dV;
+
+            // electrode charge from D_z in the first and last cell layers along the stack
+            const int kz = (AMREX_SPACEDIM == 3) ? k : j;
+            const Real Dz = eps(i,j,k)*Ez + Pz_lab;
+            if (kz == z_lo) v[D_BOT] = Dz*dA;
+            if (kz == z_hi) v[D_TOP] = Dz*dA;
+
+            return DiagReduce::ToTuple(v);
+        });
+    }
+
+    Real sums[NDIAG];
+    DiagReduce::ToArray(reduce_data.value(reduce_op), sums);
+    ParallelDescriptor::ReduceRealSum(sums, NDIAG);
+
+    const Real n_fe = amrex::max(sums[N_FE], 1.);
+    const Real n_de = amrex::max(sums[N_DE], 1.);
+    const Real n_sc = amrex::max(sums[N_SC], 1.);
+
+    // Gauss's law at the contacts: sigma = D.n with n pointing out of the metal
+    const Real Q_bot = sums[D_BOT];
+    const Real Q_top = -sums[D_TOP];
+
+    const Real nan = std::numeric_limits<Real>::quiet_NaN();
+    Real I_disp = nan;
+    Real C_diff = nan;
+    if (have_prev) {
+        if (time > prev_time) I_disp = (Q_top - prev_Q_top)/(time - prev_time);
+        if (Phi_Bc_hi != prev_V) C_diff = (Q_top - prev_Q_top)/(Phi_Bc_hi - prev_V);
+    }
+    have_prev = true;
+    prev_time = time;
+    prev_Q_top = Q_top;
+    prev_V = Phi_Bc_hi;
+
+    if (ParallelDescriptor::IOProcessor())
+    {
+        // a fresh run starts a new file, a restarted run appends to it
+        static bool first_call = true;
+        std::ofstream ofs;
+        if (first_call && restart_file.empty()) {
+            ofs.open(diag_file, std::ios::out | std::ios::trunc);
+            ofs << "step,time,Phi_Bc_hi,Px_FE,Py_FE,Pz_FE,Q_SC,Q_bot,Q_top,I_disp,C_diff,"
+                << "Ex_FE,Ey_FE,Ez_FE,Ex_DE,Ey_DE,Ez_DE,Ex_SC,Ey_SC,Ez_SC,F_Landau,F_elec,area\n";
+        } else {
+            ofs.open(diag_file, std::ios::out | std::ios::app);
+        }
+        first_call = false;
+        if (!ofs.good()) amrex::FileOpenFailed(diag_file);
+
+        ofs << std::setprecision(10) << std::scientific
+            << step << "," << time << "," << Phi_Bc_hi << ","
+            << sums[SUM_PP]/n_fe << "," << sums[SUM_PQ]/n_fe << "," << sums[SUM_PR]/n_fe << ","
+            << sums[Q_SC] << "," << Q_bot << "," << Q_top << "," << I_disp << "," << C_diff << ","
+            << sums[EX_FE]/n_fe << "," << sums[EY_FE]/n_fe << "," << sums[EZ_FE]/n_fe << ","
+            << sums[EX_DE]/n_de << "," << sums[EY_DE]/n_de << "," << sums[EZ_DE]/n_de << ","
+            << sums[EX_SC]/n_sc << "," << sums[EY_SC]/n_sc << "," << sums[EZ_SC]/n_sc << ","
+            << sums[F_LANDAU] << "," << sums[F_ELEC] << "," << area << "\n";
+    }
+}
@@ -180,6 +180,34 @@ int FerroX::plot_alpha;
 int FerroX::plot_beta;
 int FerroX::plot_theta;
 int FerroX::plot_PhiDiff;
+int FerroX::plot_grain_id;
+int FerroX::plot_static_once;
+std::string FerroX::plot_region;
+amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> FerroX::plot_lo;
+amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> FerroX::plot_hi;
+int FerroX::plot_coarsen;
+int FerroX::plot_float;
+int FerroX::plot_async_max_pending;
+
+// reduced diagnostics time series
+int FerroX::diag_int;
+std::string FerroX::diag_file;
+std::string FerroX::steady_state_criterion;
+std::string FerroX::perf_report_file;
+int FerroX::step_log_int;
+int FerroX::log_verbosity;
+int FerroX::newton_verbosity;
+int FerroX::perf_report_int;
+int FerroX::print_thread_affinity;
+int FerroX::steady_state_int;
+amrex::Real FerroX::energy_rate_tolerance;
+amrex::Real FerroX::P_change_tolerance;
+
+// checkpoint/restart
+int FerroX::chk_int;
+int FerroX::chk_keep;
+std::string FerroX::chk_file;
+std::string FerroX::restart_file;
 
 
 // multimaterial stack geometry
@@ -232,20 +260,27 @@ AMREX_GPU_MANAGED amrex::Real FerroX::metal_work_function;
 AMREX_GPU_MANAGED amrex::Real FerroX::lambda;
 AMREX_GPU_MANAGED amrex::GpuArray<int, AMREX_SPACEDIM> FerroX::P_BC_flag_lo;
 AMREX_GPU_MANAGED amrex::GpuArray<int, AMREX_SPACEDIM> FerroX::P_BC_flag_hi;
-AMREX_GPU_MANAGED amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> FerroX::Remnant_P;
+AMREX_GPU_MANAGED amrex::GpuArray<amrex::Real, 3> FerroX::Remnant_P;
 
 //problem type : initialization of P for 2D/3D/convergence problems
 AMREX_GPU_MANAGED int FerroX::prob_type;
 AMREX_GPU_MANAGED int FerroX::is_polarization_scalar;
 
 AMREX_GPU_MANAGED int FerroX::mlmg_verbosity;
+AMREX_GPU_MANAGED int FerroX::poisson_mixed_precision;
+AMREX_GPU_MANAGED amrex::Real FerroX::poisson_inner_tol;
+AMREX_GPU_MANAGED int FerroX::poisson_max_corrections;
+AMREX_GPU_MANAGED int FerroX::phi_rho_max_iter;
+AMREX_GPU_MANAGED int FerroX::compute_E_on_the_fly;
 
 AMREX_GPU_MANAGED int FerroX::TimeIntegratorOrder;
+int FerroX::wide_halo;
 
 AMREX_GPU_MANAGED amrex::Real FerroX::delta;
 
 AMREX_GPU_MANAGED int FerroX::Coordinate_Transformation;
 AMREX_GPU_MANAGED int FerroX::use_Euler_angles;
+AMREX_GPU_MANAGED int FerroX::use_grain_generator;
 
 AMREX_GPU_MANAGED amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> FerroX::t_phase_lo;
 AMREX_GPU_MANAGED amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> FerroX::t_phase_hi;
@@ -283,7 +318,7 @@ void InitializeFerroXNamespace(const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM
          }
      }
 
-     if(P_BC_flag_lo[2] == 3 || P_BC_flag_hi[2] == 3){
+     if(P_BC_flag_lo[zdir] == 3 || P_BC_flag_hi[zdir] == 3){
        amrex::Warning("This boundary condition does not represent the accurate physical picture!!");
      }
      
@@ -313,9 +348,38 @@ void InitializeFerroXNamespace(const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM
      pp.query("plot_theta",plot_theta); 
      plot_PhiDiff = 1;
      pp.query("plot_PhiDiff",plot_PhiDiff); 
+     plot_grain_id = 0;
+     pp.query("plot_grain_id",plot_grain_id); 
+     plot_static_once = 1;
+     pp.query("plot_static_once",plot_static_once);
+     plot_region = "domain";
+     pp.query("plot_region",plot_region);
+     if (plot_region != "domain" && plot_region != "FE" && plot_region != "box") {
+         amrex::Abort("plot_region must be domain, FE or box");
+     }
+     if (plot_region == "box") {
+         amrex::Vector<amrex::Real> temp;
+         pp.getarr("plot_lo",temp);
+         for (int i=0; i<AMREX_SPACEDIM; ++i) plot_lo[i] = temp[i];
+         pp.getarr("plot_hi",temp);
+         for (int i=0; i<AMREX_SPACEDIM; ++i) plot_hi[i] = temp[i];
+     }
+     plot_coarsen = 1;
+     pp.query("plot_coarsen",plot_coarsen);
+     plot_float = 0;
+     pp.query("plot_float",plot_float);
+     plot_async_max_pending = 2;
+     pp.query("plot_async_max_pending",plot_async_max_pending);
 
      pp.get("TimeIntegratorOrder",TimeIntegratorOrder);
 
+     wide_halo = 0;
+     pp.query("wide_halo",wide_halo);
+     if (wide_halo == 1 && TimeIntegratorOrder != 2) {
+         amrex::Print() << "wide_halo only applies to the predictor of TimeIntegratorOrder = 2; wide_halo is ignored\n";
+         wide_halo = 0;
+     }
+
      pp.get("prob_type", prob_type);
 
      is_polarization_scalar = 1;
@@ -324,6 +388,21 @@ void InitializeFerroXNamespace(const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM
      mlmg_verbosity = 1;
      pp.query("mlmg_verbosity",mlmg_verbosity);
 
+     poisson_mixed_precision = 0;
+     pp.query("poisson_mixed_precision",poisson_mixed_precision);
+
+     poisson_inner_tol = 1.e-4;
+     pp.query("poisson_inner_tol",poisson_inner_tol);
+
+     poisson_max_corrections = 20;
+     pp.query("poisson_max_corrections",poisson_max_corrections);
+
+     phi_rho_max_iter = 100;
+     pp.query("phi_rho_max_iter",phi_rho_max_iter);
+
+     compute_E_on_the_fly = 0;
+     pp.query("compute_E_on_the_fly",compute_E_on_the_fly);
+
      // Material Properties
 
      pp.get("epsilon_0",epsilon_0); // epsilon_0
@@ -358,6 +437,40 @@ void InitializeFerroXNamespace(const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM
      plot_int = -1;
      pp.query("plot_int",plot_int);
 
+     // reduced diagnostics every diag_int steps and at each voltage increment (off if diag_int <= 0)
+     diag_int = -1;
+     pp.query("diag_int",diag_int);
+     diag_file = "diagnostics.csv";
+     pp.query("diag_file",diag_file);
+
+     // buffered step log; newton_verbosity = 0 silences the per-iteration Newton output
+     step_log_int = 1;
+     pp.query("step_log_int",step_log_int);
+     step_log_int = amrex::max(step_log_int, 1);
+     log_verbosity = 1;
+     pp.query("log_verbosity",log_verbosity);
+     newton_verbosity = 1;
+     pp.query("newton_verbosity",newton_verbosity);
+
+     // per-run JSON performance report, with a record every perf_report_int steps if > 0
+     perf_report_file = "";
+     pp.query("perf_report_file",perf_report_file);
+     perf_report_int = -1;
+     pp.query("perf_report_int",perf_report_int);
+     print_thread_affinity = 0;
+     pp.query("print_thread_affinity",print_thread_affinity);
+
+     // checkpoint every chk_int steps (off if chk_int <= 0), keeping the newest chk_keep (all if chk_keep <= 0)
+     chk_int = -1;
+     pp.query("chk_int",chk_int);
+     chk_keep = 2;
+     pp.query("chk_keep",chk_keep);
+     chk_file = "chk";
+     pp.query("chk_file",chk_file);
+     // name of a checkpoint directory to restart from
+     restart_file = "";
+     pp.query("restart",restart_file);
+
      // time step
      pp.get("dt",dt);
 
@@ -394,6 +507,24 @@ void InitializeFerroXNamespace(const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM
      phi_tolerance = 1.e-7;
      pp.query("phi_tolerance",phi_tolerance);
 
+     // energy: relative free-energy change per step and max |dP| per step, checked every steady_state_int steps
+     steady_state_criterion = "phi";
+     pp.query("steady_state_criterion",steady_state_criterion);
+     if (steady_state_criterion != "phi" && steady_state_criterion != "energy") {
+         amrex::Abort("steady_state_criterion must be phi or energy");
+     }
+     if (steady_state_criterion == "energy" && plot_PhiDiff) {
+         amrex::Print() << "steady_state_criterion = energy does not compute PhiDiff; plot_PhiDiff is ignored\n";
+         plot_PhiDiff = 0;
+     }
+     steady_state_int = 1;
+     pp.query("steady_state_int",steady_state_int);
+     steady_state_int = amrex::max(steady_state_int, 1);
+     energy_rate_tolerance = 1.e-8;
+     pp.query("energy_rate_tolerance",energy_rate_tolerance);
+     P_change_tolerance = 1.e-7;
+     pp.query("P_change_tolerance",P_change_tolerance);
+
      random_seed = 1;
      pp.query("random_seed",random_seed);
 
@@ -483,9 +614,12 @@ void InitializeFerroXNamespace(const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM
          }
      }
 
-     if (pp.queryarr("Remnant_P",temp)) {
-         for (int i=0; i<AMREX_SPACEDIM; ++i) {
-             Remnant_P[i] = temp[i];
+     // polarization always has three components, also when DIM=2
+     amrex::Vector<amrex::Real> temp_P(3);
+     if (pp.queryarr("Remnant_P",temp_P)) {
+         if (temp_P.size() != 3) amrex::Abort("Remnant_P requires three values (Px Py Pz)");
+         for (int i=0; i<3; ++i) {
+             Remnant_P[i] = temp_P[i];
          }
      }
 
@@ -533,6 +667,9 @@ void InitializeFerroXNamespace(const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM
      
      use_Euler_angles = 0;
      pp.query("use_Euler_angles",use_Euler_angles);
+
+     use_grain_generator = 0;
+     pp.query("use_grain_generator",use_grain_generator);
 }
 
 
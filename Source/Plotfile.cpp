@@ -1,34 +1,222 @@
 #include "FerroX.H"
 #include "AMReX_PlotFileUtil.H"
+#include "AMReX_AsyncOut.H"
 #include "Input/GeometryProperties/GeometryProperties.H"
+#include "Utils/FerroXUtils/PerfCounters.H"
+
+#include <atomic>
+#include <cmath>
+
+// Plotfile I/O accounting. With amrex.async_out = 1, WriteSingleLevelPlotfile copies Plt
+// into a staging buffer and the files are written by the AMReX background thread; a marker
+// task queued behind each write records when it has finished.
+namespace {
+    int plt_submitted = 0;
+    std::atomic<int> plt_completed{0};
+    std::atomic<double> plt_background_time{0.};
+    Real plt_exposed_time = 0.;  // snapshot + submit (or the whole write when synchronous)
+    Real plt_wait_time = 0.;     // blocked on in-flight writes
+
+    void DrainPlotfileWrites ()
+    {
+        Real t0 = ParallelDescriptor::second();
+        amrex::AsyncOut::Finish();
+        plt_wait_time += ParallelDescriptor::second() - t0;
+    }
+
+    // called right after a plotfile has been handed to WriteReducedPlotfile
+    void CountPlotfileWrite ()
+    {
+        ++plt_submitted;
+
+        if (amrex::AsyncOut::UseAsyncOut()) {
+            const double submit_time = ParallelDescriptor::second();
+            amrex::AsyncOut::Submit([submit_time] ()
+            {
+                const double dt_write = ParallelDescriptor::second() - submit_time;
+                double old = plt_background_time.load();
+                while (!plt_background_time.compare_exchange_weak(old, old + dt_write)) {}
+                ++plt_completed;
+            });
+        } else {
+            ++plt_completed;
+        }
+    }
+
+    // bound the staging memory held by snapshots that are still being written
+    void BoundPendingPlotfileWrites ()
+    {
+        if (plt_submitted - plt_completed.load() >= amrex::max(plot_async_max_pending, 1)) {
+            DrainPlotfileWrites();
+        }
+    }
+}
+
+// Output reduction (plot_region, plot_coarsen, plot_float), applied to the assembled Plt.
+// Boxes are clipped to the region of interest on the rank that owns them, so the copy is
+// local; coarsening averages continuous fields and samples categorical ones (masks, IDs).
+static Box PlotRegionBox (const Geometry& geom, int c)
+{
+    const Box& domain = geom.Domain();
+    if (plot_region == "domain") return domain;
+
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> lo = plot_lo;
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> hi = plot_hi;
+    if (plot_region == "FE") {
+        lo = FE_lo;
+        hi = FE_hi;
+    }
+
+    IntVect ilo, ihi;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        // cells whose centres lie inside [lo,hi], grown outward to a multiple of the coarsening factor
+        int l = static_cast<int>(std::ceil((lo[d] - geom.ProbLo(d))/geom.CellSize(d) - 0.5));
+        int h = static_cast<int>(std::floor((hi[d] - geom.ProbLo(d))/geom.CellSize(d) - 0.5));
+        l = amrex::max(l, domain.smallEnd(d));
+        h = amrex::min(h, domain.bigEnd(d));
+        ilo[d] = (l/c)*c;
+        ihi[d] = ((h+c)/c)*c - 1;
+    }
+    Box roi(ilo, ihi);
+    roi &= domain;
+    if (!roi.ok()) amrex::Abort("WritePlotfile: plot region does not intersect the domain");
+    return roi;
+}
+
+static void WriteReducedPlotfile (const std::string& pltfile, const MultiFab& Plt,
+                                  const Vector<std::string>& var_names,
+                                  const Geometry& geom, Real time, int plt_step)
+{
+    const int c = amrex::max(plot_coarsen, 1);
+    const Box roi = PlotRegionBox(geom, c);
+
+    const MultiFab* out = &Plt;
+    Geometry out_geom = geom;
+    MultiFab roi_mf, crse_mf;
+
+    if (roi != geom.Domain() || c > 1) {
+
+        if (!geom.Domain().coarsenable(c)) {
+            amrex::Abort("WritePlotfile: n_cell must be divisible by plot_coarsen");
+        }
+
+        // clip each box to the region; the clipped box stays on the rank that owns it
+        BoxList bl;
+        Vector<int> owners;
+        const BoxArray& ba = Plt.boxArray();
+        const DistributionMapping& dm = Plt.DistributionMap();
+        for (int n = 0; n < ba.size(); ++n) {
+            Box b = ba[n] & roi;
+            if (b.ok()) {
+                bl.push_back(b);
+                owners.push_back(dm[n]);
+            }
+        }
+        BoxArray roi_ba(std::move(bl));
+        DistributionMapping roi_dm(std::move(owners));
+        roi_mf.define(roi_ba, roi_dm, Plt.nComp(), 0);
+        roi_mf.ParallelCopy(Plt, 0, 0, Plt.nComp());
+        out = &roi_mf;
+
+        if (c > 1) {
+            if (!roi_ba.coarsenable(c)) {
+                amrex::Abort("WritePlotfile: grid boxes must be divisible by plot_coarsen");
+            }
+
+            const int ncomp = Plt.nComp();
+            Gpu::DeviceVector<int> d_categorical(ncomp, 0);
+            {
+                Vector<int> h_categorical(ncomp, 0);
+                for (int n = 0; n < ncomp; ++n) {
+                    h_categorical[n] = (var_names[n] == "mask" || var_names[n] == "tphase" ||
+                                        var_names[n] == "grain_id") ? 1 : 0;
+                }
+                Gpu::copy(Gpu::hostToDevice, h_categorical.begin(), h_categorical.end(), d_categorical.begin());
+            }
+            const int* categorical = d_categorical.data();
+
+            crse_mf.define(amrex::coarsen(roi_ba, c), roi_dm, ncomp, 0);
+            const int cx = c;
+            const int cy = (AMREX_SPACEDIM > 1) ? c : 1;
+            const int cz = (AMREX_SPACEDIM > 2) ? c : 1;
+            const Real inv_nfine = 1.0/(cx*cy*cz);
+
+            for (MFIter mfi(crse_mf, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+            {
+                const Box& bx = mfi.tilebox();
+                const auto& fine = roi_mf.const_array(mfi);
+                const auto& crse = crse_mf.array(mfi);
+
+                amrex::ParallelFor(bx, ncomp, [=] AMREX_GPU_DEVICE (int i, int j, int k, int n) noexcept
+                {
+                    const int fi = i*cx;
+                    const int fj = j*cy;
+                    const int fk = k*cz;
+                    if (categorical[n]) {
+                        crse(i,j,k,n) = fine(fi,fj,fk,n);
+                    } else {
+                        Real sum = 0.;
+                        for (int kk = 0; kk < cz; ++kk) {
+                        for (int jj = 0; jj < cy; ++jj) {
+                        for (int ii = 0; ii < cx; ++ii) {
+                            sum += fine(fi+ii,fj+jj,fk+kk,n);
+                        }
+                        }
+                        }
+                        crse(i,j,k,n) = sum*inv_nfine;
+                    }
+                });
+            }
+            Gpu::streamSynchronize();
+            roi_mf.clear();
+            out = &crse_mf;
+            out_geom = Geometry(amrex::coarsen(geom.Domain(), c), geom.ProbDomain(),
+                                geom.Coord(), geom.isPeriodic());
+        }
+    }
+
+    // single precision on disk; the asynchronous writer always uses native precision
+    const FABio::Format old_format = FArrayBox::getFormat();
+    if (plot_float == 1) FArrayBox::setFormat(FABio::FAB_NATIVE_32);
+
+    WriteSingleLevelPlotfile(pltfile, *out, var_names, out_geom, time, plt_step);
+
+    FArrayBox::setFormat(old_format);
+}
 
 void WritePlotfile(c_FerroX& rFerroX,
                    MultiFab& PoissonPhi,
                    MultiFab& PoissonRHS,
-                   Array< MultiFab, AMREX_SPACEDIM>& P_old,
-                   Array< MultiFab, AMREX_SPACEDIM>& E,
+                   Array< MultiFab, 3>& P_old,
+                   Array< MultiFab, 3>& E,
                    MultiFab& hole_den,
                    MultiFab& e_den,
                    MultiFab& charge_den,
                    MultiFab& beta_cc,
-                   MultiFab& MaterialMask,
-                   MultiFab& tphaseMask,
-                   MultiFab& angle_alpha,
-                   MultiFab& angle_beta,
-                   MultiFab& angle_theta,
+                   MaskMultiFab& MaterialMask,
+                   MaskMultiFab& tphaseMask,
+                   StaticMultiFab& angle_alpha,
+                   StaticMultiFab& angle_beta,
+                   StaticMultiFab& angle_theta,
                    MultiFab& Phidiff,
+                   iMultiFab& GrainID,
                    const Geometry& geom,
                    const Real& time,
                    const int& plt_step)
 {
     // timer for profiling
     BL_PROFILE_VAR("WritePlotfile()",WritePlotfile);
+    FerroX_Perf::Region perf_region("WritePlotfile()");
+    const Real plt_strt_time = ParallelDescriptor::second();
 
     BoxArray ba = PoissonPhi.boxArray();
     DistributionMapping dm = PoissonPhi.DistributionMap();
 
     const std::string& pltfile = amrex::Concatenate("plt",plt_step,8);
 
+    // fields that do not change during a run go to plt_static unless plot_static_once = 0
+    const bool plot_static = (plot_static_once == 0);
+
     Vector<std::string> var_names;
 
     //Px, Py, Pz
@@ -70,32 +258,32 @@ void WritePlotfile(c_FerroX& rFerroX,
         var_names.push_back("charge");
     }
 
-    if (plot_epsilon) {
+    if (plot_static && plot_epsilon) {
         ++nvar;
         var_names.push_back("epsilon");
     }
 
-    if (plot_mask) {
+    if (plot_static && plot_mask) {
         ++nvar;
         var_names.push_back("mask");
     }
 
-    if (plot_tphase) {
+    if (plot_static && plot_tphase) {
         ++nvar;
         var_names.push_back("tphase");
     }
 
-    if (plot_alpha) {
+    if (plot_static && plot_alpha) {
         ++nvar;
         var_names.push_back("alpha");
     }
 
-    if (plot_beta) {
+    if (plot_static && plot_beta) {
         ++nvar;
         var_names.push_back("beta");
     }
 
-    if (plot_theta) {
+    if (plot_static && plot_theta) {
         ++nvar;
         var_names.push_back("theta");
     }
@@ -105,6 +293,12 @@ void WritePlotfile(c_FerroX& rFerroX,
         var_names.push_back("PhiDiff");
     }
 
+    const bool write_grain_id = plot_static && plot_grain_id && GrainID.ok();
+    if (write_grain_id) {
+        ++nvar;
+        var_names.push_back("grain_id");
+    }
+
 
 
     auto& rGprop = rFerroX.get_GeometryProperties();
@@ -146,33 +340,119 @@ void WritePlotfile(c_FerroX& rFerroX,
         MultiFab::Copy(Plt, charge_den, 0, counter++, 1, 0);
     }
 
-    if (plot_epsilon) {
+    if (plot_static && plot_epsilon) {
         MultiFab::Copy(Plt, beta_cc, 0, counter++, 1, 0);
     }
 
-    if (plot_mask) {
-        MultiFab::Copy(Plt, MaterialMask, 0, counter++, 1, 0);
+    if (plot_static && plot_mask) {
+        amrex::Copy(Plt, MaterialMask, 0, counter++, 1, 0);
     }
 
-    if (plot_tphase) {
-        MultiFab::Copy(Plt, tphaseMask, 0, counter++, 1, 0);
+    if (plot_static && plot_tphase) {
+        amrex::Copy(Plt, tphaseMask, 0, counter++, 1, 0);
     }
 
-    if (plot_alpha) {
-        MultiFab::Copy(Plt, angle_alpha, 0, counter++, 1, 0);
+    if (plot_static && plot_alpha) {
+        amrex::Copy(Plt, angle_alpha, 0, counter++, 1, 0);
     }
 
-    if (plot_beta) {
-        MultiFab::Copy(Plt, angle_beta, 0, counter++, 1, 0);
+    if (plot_static && plot_beta) {
+        amrex::Copy(Plt, angle_beta, 0, counter++, 1, 0);
     }
 
-    if (plot_theta) {
-        MultiFab::Copy(Plt, angle_theta, 0, counter++, 1, 0);
+    if (plot_static && plot_theta) {
+        amrex::Copy(Plt, angle_theta, 0, counter++, 1, 0);
     }
 
     if (plot_PhiDiff) {
         MultiFab::Copy(Plt, Phidiff, 0, counter++, 1, 0);
     }
 
-    WriteSingleLevelPlotfile(pltfile, Plt, var_names, geom, time, plt_step);
+    if (write_grain_id) {
+        amrex::Copy(Plt, GrainID, 0, counter++, 1, 0);
+    }
+
+    WriteReducedPlotfile(pltfile, Plt, var_names, geom, time, plt_step);
+    CountPlotfileWrite();
+
+    BL_PROFILE_VAR_STOP(WritePlotfile);
+    plt_exposed_time += ParallelDescriptor::second() - plt_strt_time;
+
+    BoundPendingPlotfileWrites();
+}
+
+void WriteStaticPlotfile(c_FerroX& rFerroX,
+                         MultiFab& beta_cc,
+                         MaskMultiFab& MaterialMask,
+                         MaskMultiFab& tphaseMask,
+                         StaticMultiFab& angle_alpha,
+                         StaticMultiFab& angle_beta,
+                         StaticMultiFab& angle_theta,
+                         iMultiFab& GrainID,
+                         const Geometry& geom)
+{
+    // timer for profiling
+    BL_PROFILE_VAR("WriteStaticPlotfile()",WriteStaticPlotfile);
+    FerroX_Perf::Region perf_region("WriteStaticPlotfile()");
+    const Real plt_strt_time = ParallelDescriptor::second();
+
+    Vector<std::string> var_names;
+    if (plot_epsilon) var_names.push_back("epsilon");
+    if (plot_mask)    var_names.push_back("mask");
+    if (plot_tphase)  var_names.push_back("tphase");
+    if (plot_alpha)   var_names.push_back("alpha");
+    if (plot_beta)    var_names.push_back("beta");
+    if (plot_theta)   var_names.push_back("theta");
+    const bool write_grain_id = plot_grain_id && GrainID.ok();
+    if (write_grain_id) var_names.push_back("grain_id");
+
+    if (var_names.empty()) return;
+
+    auto& rGprop = rFerroX.get_GeometryProperties();
+#ifdef AMREX_USE_EB
+    MultiFab Plt(beta_cc.boxArray(), beta_cc.DistributionMap(), var_names.size(), 0,  MFInfo(), *rGprop.pEB->p_factory_union);
+#else
+    MultiFab Plt(beta_cc.boxArray(), beta_cc.DistributionMap(), var_names.size(), 0);
+#endif
+
+    int counter = 0;
+    if (plot_epsilon)   MultiFab::Copy(Plt, beta_cc, 0, counter++, 1, 0);
+    if (plot_mask)      amrex::Copy(Plt, MaterialMask, 0, counter++, 1, 0);
+    if (plot_tphase)    amrex::Copy(Plt, tphaseMask, 0, counter++, 1, 0);
+    if (plot_alpha)     amrex::Copy(Plt, angle_alpha, 0, counter++, 1, 0);
+    if (plot_beta)      amrex::Copy(Plt, angle_beta, 0, counter++, 1, 0);
+    if (plot_theta)     amrex::Copy(Plt, angle_theta, 0, counter++, 1, 0);
+    if (write_grain_id) amrex::Copy(Plt, GrainID, 0, counter++, 1, 0);
+
+    // goes through the same path as the per-step plotfiles (asynchronous with amrex.async_out = 1)
+    // and is counted and bounded the same way
+    WriteReducedPlotfile("plt_static", Plt, var_names, geom, 0., 0);
+    CountPlotfileWrite();
+
+    BL_PROFILE_VAR_STOP(WriteStaticPlotfile);
+    plt_exposed_time += ParallelDescriptor::second() - plt_strt_time;
+
+    BoundPendingPlotfileWrites();
+}
+
+void FinishPlotfileOutput()
+{
+    if (amrex::AsyncOut::UseAsyncOut()) DrainPlotfileWrites();
+}
+
+void PrintPlotfileTiming()
+{
+    Real times[3] = {plt_exposed_time, plt_wait_time, static_cast<Real>(plt_background_time.load())};
+    ParallelDescriptor::ReduceRealMax(times, 3, ParallelDescriptor::IOProcessorNumber());
+
+    amrex::Print() << "Plotfile output: " << plt_submitted << " files";
+    if (amrex::AsyncOut::UseAsyncOut()) {
+        // background time includes queueing behind earlier writes, so hidden time is an estimate
+        const Real hidden = amrex::max(times[2] - times[1], 0.);
+        amrex::Print() << " (asynchronous), exposed " << times[0] + times[1]
+                       << " s (snapshot " << times[0] << " s, waiting " << times[1]
+                       << " s), hidden ~" << hidden << " s\n";
+    } else {
+        amrex::Print() << " (synchronous), exposed " << times[0] << " s\n";
+    }
 }
\ No newline at end of file
@@ -0,0 +1,561 @@
+#include "ColumnSolver.H"
+#include "DerivativeAlgorithm.H"
+#include "ChargeDensity.H"
+#include "TotalEnergyDensity.H"
+#include "Input/GeometryProperties/GeometryProperties.H"
+
+#include <AMReX_ParmParse.H>
+#include <AMReX_ParallelDescriptor.H>
+
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+namespace {
+
+// cell-centered data along the stack-normal direction with ng ghost cells on each side
+template <typename T>
+struct ColumnT
+{
+    int nz = 0;
+    int ng = 2;
+    amrex::Vector<T> v;
+
+    void define (int a_nz) { nz = a_nz; v.assign(nz + 2*ng, T(0)); }
+
+    T& operator() (int kz)       { return v[kz+ng]; }
+    T  operator() (int kz) const { return v[kz+ng]; }
+
+    // view the column as an Array4 so that the stencils in DerivativeAlgorithm.H can be reused
+    amrex::Array4<T> array ()
+    {
+#if (AMREX_SPACEDIM == 3)
+        return amrex::Array4<T>(v.data(), amrex::Dim3{0,0,-ng}, amrex::Dim3{1,1,nz+ng}, 1);
+#else
+        return amrex::Array4<T>(v.data(), amrex::Dim3{0,-ng,0}, amrex::Dim3{1,nz+ng,1}, 1);
+#endif
+    }
+};
+
+using Column = ColumnT<amrex::Real>;
+using MaskColumn = ColumnT<MaskType>;
+
+struct ColumnOptions
+{
+    int nz;
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> prob_lo;
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> prob_hi;
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> position; // lateral position of the column
+    std::string plot_file;
+    int output_int;
+    int write_profile;
+    int max_newton_iter;
+    int verbose;
+};
+
+struct ColumnSummary
+{
+    amrex::Real Pz_avg = 0.;
+    amrex::Real Q_top = 0.;
+    amrex::Real Phi_Bc_hi = 0.;
+    int steps = 0;
+};
+
+// parameters that can be varied with column.sweep_param
+std::map<std::string, amrex::Real*> ColumnSweepParameters ()
+{
+    return { {"alpha", &FerroX::alpha}, {"beta", &FerroX::beta}, {"gamma", &FerroX::gamma},
+             {"alpha_12", &alpha_12}, {"alpha_112", &alpha_112}, {"alpha_123", &alpha_123},
+             {"BigGamma", &BigGamma}, {"g11", &g11}, {"g44", &g44}, {"g44_p", &g44_p}, {"g12", &g12},
+             {"epsilonX_fe", &epsilonX_fe}, {"epsilon_de", &epsilon_de}, {"epsilon_si", &epsilon_si},
+             {"lambda", &lambda}, {"acceptor_doping", &acceptor_doping}, {"donor_doping", &donor_doping},
+             {"metal_work_function", &metal_work_function}, {"Phi_Bc_lo", &Phi_Bc_lo},
+             {"Phi_Bc_hi", &Phi_Bc_hi}, {"dt", &dt} };
+}
+
+// same region logic as InitializeMaterialMask
+MaskType ColumnMaterialID (amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& pos)
+{
+    auto inside = [&] (amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& lo,
+                       amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& hi)
+    {
+        bool in = true;
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) in = in && pos[d] >= lo[d] && pos[d] <= hi[d];
+        return in;
+    };
+
+    //FE:0, DE:1, Source/Drain:2, Channel:3
+    if (inside(FE_lo, FE_hi)) return FE;
+    if (inside(DE_lo, DE_hi)) return DE;
+    if (inside(SC_lo, SC_hi)) return inside(Channel_lo, Channel_hi) ? Channel : SC;
+    return DE; //spacer is DE
+}
+
+// Dirichlet values in the ghost cells below and above the stack, as in SetPhiBC_z
+void ColumnSetPhiBC (Column& phi)
+{
+    amrex::Real Eg = bandgap;
+    amrex::Real Chi = affinity;
+    amrex::Real phi_ref = Chi + 0.5*Eg + 0.5*kb*T*log(Nc/Nv)/q;
+    amrex::Real phi_m = use_work_function ? metal_work_function : phi_ref;
+    for (int g = 1; g <= phi.ng; ++g) {
+        phi(-g) = Phi_Bc_lo;
+        phi(phi.nz-1+g) = Phi_Bc_hi - (phi_m - phi_ref);
+    }
+}
+
+// Thomas algorithm for a(k) x(k-1) + d(k) x(k) + c(k) x(k+1) = r(k); overwrites c and r
+void SolveTridiagonal (amrex::Vector<amrex::Real> const& a, amrex::Vector<amrex::Real> const& d,
+                       amrex::Vector<amrex::Real>& c, amrex::Vector<amrex::Real>& r,
+                       Column& x)
+{
+    const int n = static_cast<int>(d.size());
+    c[0] = c[0] / d[0];
+    r[0] = r[0] / d[0];
+    for (int k = 1; k < n; ++k) {
+        amrex::Real m = d[k] - a[k]*c[k-1];
+        c[k] = c[k] / m;
+        r[k] = (r[k] - a[k]*r[k-1]) / m;
+    }
+    x(n-1) = r[n-1];
+    for (int k = n-2; k >= 0; --k) {
+        x(k) = r[k] - c[k]*x(k+1);
+    }
+}
+
+// Column counterpart of ComputePoissonRHS with no lateral variation and no rotation
+void ColumnPoissonRHS (Column& rhs, Column& Pr, Column& rho, MaskColumn& mask,
+                       amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& dx)
+{
+    auto const& pr_arr = Pr.array();
+    auto const& mask_arr = mask.array();
+    for (int kz = 0; kz < rhs.nz; ++kz) {
+        if (mask(kz) >= SC) { //SC region
+            rhs(kz) = rho(kz);
+        } else if (mask(kz) == DE) { //DE region
+            rhs(kz) = 0.;
+        } else { //FE region
+            rhs(kz) = -DPDz(pr_arr, mask_arr, 0, zj*kz, zk*kz, dx);
+        }
+    }
+}
+
+void ColumnComputeRho (Column& phi, Column& rho, Column& e_den, Column& h_den, MaskColumn& mask)
+{
+    for (int kz = 0; kz < phi.nz; ++kz) {
+        if (mask(kz) >= SC) {
+            ComputeRhoPointwise(phi(kz), e_den(kz), h_den(kz), rho(kz));
+        } else {
+            rho(kz) = 0.0;
+        }
+    }
+}
+
+// Newton iteration for self-consistent phi and rho, mirroring ComputePhi_Rho.
+// Returns the number of Newton iterations.
+int ColumnComputePhi_Rho (Column& phi, Column& Pr, Column& rho, Column& e_den, Column& h_den,
+                          MaskColumn& mask, amrex::Vector<amrex::Real> const& eps_face,
+                          amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& dx,
+                          bool contains_SC, int max_iter)
+{
+    const int nz = phi.nz;
+    const amrex::Real dz2 = dx[zdir]*dx[zdir];
+
+    Column rhs; rhs.define(nz);
+    Column phi_prev; phi_prev.define(nz);
+    amrex::Vector<amrex::Real> a(nz), d(nz), c(nz), r(nz);
+
+    ColumnSetPhiBC(phi);
+
+    amrex::Real tol = 1.e-5;
+    amrex::Real err = 1.0;
+    int iter = 0;
+
+    while (err > tol) {
+
+        ColumnPoissonRHS(rhs, Pr, rho, mask, dx);
+
+        for (int kz = 0; kz < nz; ++kz) {
+            // alpha = d(RHS)/d(phi), only nonzero in SC cells
+            amrex::Real alpha_cc = 0.;
+            if (mask(kz) >= SC) {
+                amrex::Real e_d, h_d, rho_d;
+                ComputeRhoPointwise(phi(kz) + delta, e_d, h_d, rho_d);
+                alpha_cc = (rho_d - rho(kz)) / delta;
+            }
+
+            // face-located Dirichlet values at the metal contacts
+            amrex::Real wl = (kz == 0)    ? 2.*eps_face[0]/dz2  : eps_face[kz]/dz2;
+            amrex::Real wu = (kz == nz-1) ? 2.*eps_face[nz]/dz2 : eps_face[kz+1]/dz2;
+
+            // (-alpha - div beta grad) phi = RHS - alpha*phi_old
+            a[kz] = (kz == 0)    ? 0. : -wl;
+            c[kz] = (kz == nz-1) ? 0. : -wu;
+            d[kz] = wl + wu - alpha_cc;
+            r[kz] = rhs(kz) - alpha_cc*phi(kz);
+            if (kz == 0)    r[kz] += wl*phi(-1);
+            if (kz == nz-1) r[kz] += wu*phi(nz);
+        }
+
+        SolveTridiagonal(a, d, c, r, phi);
+
+        ColumnComputeRho(phi, rho, e_den, h_den, mask);
+
+        if (!contains_SC) {
+            err = 0.;
+        } else {
+            if (iter > 0) {
+                amrex::Real diff = 0., norm = 0.;
+                for (int kz = 0; kz < nz; ++kz) {
+                    diff += std::abs(phi(kz) - phi_prev(kz));
+                    norm += std::abs(phi(kz));
+                }
+                err = (norm > 0.) ? diff/norm : diff;
+            }
+            phi_prev.v = phi.v;
+            iter = iter + 1;
+            if (iter >= max_iter) {
+                amrex::AllPrint() << "Column solver: no self consistency between Phi and Rho in "
+                                  << max_iter << " iterations, err = " << err << std::endl;
+                break;
+            }
+        }
+    }
+    return iter;
+}
+
+void ColumnEfromPhi (Column& Er, Column& phi,
+                     amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& dx,
+                     amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& prob_lo,
+                     amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& prob_hi)
+{
+    auto const& phi_arr = phi.array();
+    for (int kz = 0; kz < phi.nz; ++kz) {
+        amrex::Real z_hi = prob_lo[zdir] + (kz+1.5) * dx[zdir];
+        amrex::Real z_lo = prob_lo[zdir] + (kz-0.5) * dx[zdir];
+        Er(kz) = -DphiDz(phi_arr, z_hi, z_lo, 0, zj*kz, zk*kz, dx, prob_lo, prob_hi);
+    }
+}
+
+// Column counterpart of CalculateTDGL_RHS: only stack-normal gradients, Ex = Ey = 0
+void ColumnTDGL_RHS (std::array<Column,3>& rhs, std::array<Column,3>& P, Column& Er,
+                     Column& Gam, MaskColumn& mask,
+                     amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& dx)
+{
+    auto const& pp_arr = P[0].array();
+    auto const& pq_arr = P[1].array();
+    auto const& pr_arr = P[2].array();
+    auto const& mask_arr = mask.array();
+
+    for (int kz = 0; kz < Er.nz; ++kz) {
+        const int j = zj*kz;
+        const int k = zk*kz;
+        amrex::Real Pp = P[0](kz);
+        amrex::Real Pq = P[1](kz);
+        amrex::Real Pr = P[2](kz);
+
+        amrex::Real dFdPp = dFdP_Landau(Pp, Pq, Pr) - (g44 + g44_p) * DoubleDPDz(pp_arr, mask_arr, 0, j, k, dx);
+        amrex::Real dFdPq = dFdP_Landau(Pq, Pp, Pr) - (g44 - g44_p) * DoubleDPDz(pq_arr, mask_arr, 0, j, k, dx);
+        amrex::Real dFdPr = dFdP_Landau(Pr, Pp, Pq) - g11 * DoubleDPDz(pr_arr, mask_arr, 0, j, k, dx);
+
+        rhs[0](kz) = -1.0 * Gam(kz) * dFdPp;
+        rhs[1](kz) = -1.0 * Gam(kz) * dFdPq;
+        rhs[2](kz) = -1.0 * Gam(kz) * (dFdPr - Er(kz));
+
+        if (is_polarization_scalar == 1) {
+            rhs[0](kz) = 0.0;
+            rhs[1](kz) = 0.0;
+        }
+    }
+}
+
+ColumnSummary RunColumn (ColumnOptions const& opt, std::string const& tag)
+{
+    const int nz = opt.nz;
+    const auto& prob_lo = opt.prob_lo;
+    const auto& prob_hi = opt.prob_hi;
+
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> dx;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) dx[d] = 1.0; // lateral spacing is never used
+    dx[zdir] = (prob_hi[zdir] - prob_lo[zdir]) / nz;
+
+    MaskColumn mask;
+    Column eps, Gam, phi, phi_old, rho, e_den, h_den, Er;
+    std::array<Column,3> P_old, P_new_pre, P_new, GL_rhs, GL_rhs_pre;
+    mask.define(nz);
+    for (Column* col : {&eps, &Gam, &phi, &phi_old, &rho, &e_den, &h_den, &Er}) col->define(nz);
+    for (int i = 0; i < 3; ++i) {
+        P_old[i].define(nz); P_new_pre[i].define(nz); P_new[i].define(nz);
+        GL_rhs[i].define(nz); GL_rhs_pre[i].define(nz);
+    }
+
+    // material IDs including ghost cells, so that the FE boundary stencils see the metal/DE neighbours
+    bool contains_SC = false;
+    for (int kz = -mask.ng; kz < nz + mask.ng; ++kz) {
+        auto pos = opt.position;
+        pos[zdir] = prob_lo[zdir] + (kz+0.5) * dx[zdir];
+        mask(kz) = ColumnMaterialID(pos);
+        if (kz >= 0 && kz < nz && mask(kz) >= SC) contains_SC = true;
+    }
+
+    // uniform poled start: laterally homogeneous P = Remnant_P in FE
+    int n_fe = 0;
+    for (int kz = 0; kz < nz; ++kz) {
+        if (mask(kz) == FE) {
+            for (int i = 0; i < 3; ++i) P_old[i](kz) = Remnant_P[i];
+            Gam(kz) = BigGamma;
+            eps(kz) = epsilonX_fe * epsilon_0;
+            ++n_fe;
+        } else if (mask(kz) == DE) {
+            eps(kz) = epsilon_de * epsilon_0;
+        } else {
+            eps(kz) = epsilon_si * epsilon_0;
+            h_den(kz) = intrinsic_carrier_concentration;
+            e_den(kz) = intrinsic_carrier_concentration;
+            rho(kz) = q*(h_den(kz) - e_den(kz) - acceptor_doping + donor_doping);
+        }
+        if (is_polarization_scalar == 1) {
+            P_old[0](kz) = 0.0;
+            P_old[1](kz) = 0.0;
+        }
+    }
+
+    // permittivity on cell faces; the contact faces take the adjacent cell value as in InitializePermittivity
+    amrex::Vector<amrex::Real> eps_face(nz+1);
+    eps_face[0] = eps(0);
+    eps_face[nz] = eps(nz-1);
+    for (int f = 1; f < nz; ++f) eps_face[f] = 0.5*(eps(f-1) + eps(f));
+
+    std::ofstream ofs;
+    if (opt.output_int >= 0) {
+        ofs.open(opt.plot_file + tag + ".csv");
+        ofs << "step,time,Phi_Bc_hi,Pz_avg_FE,Q_top,newton_iters\n";
+        ofs << std::setprecision(10);
+    }
+
+    auto diagnostics = [&] (ColumnSummary& s)
+    {
+        amrex::Real sum = 0.;
+        for (int kz = 0; kz < nz; ++kz) if (mask(kz) == FE) sum += P_old[2](kz);
+        s.Pz_avg = (n_fe > 0) ? sum/n_fe : 0.;
+        // charge per area on the top contact, -D_z at the top face
+        amrex::Real Ez_top = -(phi(nz) - phi(nz-1)) / (0.5*dx[zdir]);
+        s.Q_top = -(eps_face[nz]*Ez_top + P_old[2](nz-1));
+        s.Phi_Bc_hi = Phi_Bc_hi;
+    };
+
+    ColumnSummary summary;
+    amrex::Real time = 0.0;
+
+    int newton_iters = ColumnComputePhi_Rho(phi, P_old[2], rho, e_den, h_den, mask, eps_face, dx, contains_SC, opt.max_newton_iter);
+    ColumnEfromPhi(Er, phi, dx, prob_lo, prob_hi);
+    phi_old.v = phi.v;
+
+    auto write_row = [&] (int step)
+    {
+        if (!ofs.is_open()) return;
+        diagnostics(summary);
+        ofs << step << "," << time << "," << Phi_Bc_hi << "," << summary.Pz_avg << ","
+            << summary.Q_top << "," << newton_iters << "\n";
+    };
+    write_row(0);
+
+    int steady_state_step = 1000000;
+    int sign = 1;
+    int num_Vapp = 0;
+    amrex::Real tiny = 1.e-6;
+    int step = 1;
+
+    for (; step <= nsteps; ++step)
+    {
+        ColumnTDGL_RHS(GL_rhs, P_old, Er, Gam, mask, dx);
+
+        for (int i = 0; i < 3; ++i) {
+            for (int kz = 0; kz < nz; ++kz) P_new_pre[i](kz) = P_old[i](kz) + dt*GL_rhs[i](kz);
+        }
+        newton_iters = ColumnComputePhi_Rho(phi, P_new_pre[2], rho, e_den, h_den, mask, eps_face, dx, contains_SC, opt.max_newton_iter);
+
+        if (TimeIntegratorOrder == 1) {
+            for (int i = 0; i < 3; ++i) P_old[i].v = P_new_pre[i].v;
+        } else {
+            ColumnTDGL_RHS(GL_rhs_pre, P_new_pre, Er, Gam, mask, dx);
+            for (int i = 0; i < 3; ++i) {
+                for (int kz = 0; kz < nz; ++kz) {
+                    P_new[i](kz) = P_old[i](kz) + dt*(0.5*GL_rhs[i](kz) + 0.5*GL_rhs_pre[i](kz));
+                }
+            }
+            newton_iters = ColumnComputePhi_Rho(phi, P_new[2], rho, e_den, h_den, mask, eps_face, dx, contains_SC, opt.max_newton_iter);
+            for (int i = 0; i < 3; ++i) P_old[i].v = P_new[i].v;
+        }
+
+        // steady state check, as in CheckSteadyState
+        amrex::Real phi_max = 0., diff_max = 0.;
+        for (int kz = 0; kz < nz; ++kz) {
+            phi_max = std::max(phi_max, std::abs(phi_old(kz)));
+            diff_max = std::max(diff_max, std::abs(phi(kz) - phi_old(kz)));
+        }
+        amrex::Real max_phi_err = (phi_max > 0.) ? diff_max/phi_max : diff_max;
+        if (step > 1 && max_phi_err < phi_tolerance) {
+            steady_state_step = step;
+            inc_step = step;
+        }
+        phi_old.v = phi.v;
+
+        ColumnEfromPhi(Er, phi, dx, prob_lo, prob_hi);
+
+        time = time + dt;
+
+        if ((opt.output_int > 0 && step%opt.output_int == 0) || step == steady_state_step) {
+            write_row(step);
+        }
+
+        if (voltage_sweep == 1 && inc_step > 0 && step == inc_step)
+        {
+            Phi_Bc_hi += sign*Phi_Bc_inc;
+            num_Vapp += 1;
+            if (std::abs(std::abs(Phi_Bc_hi) - Phi_Bc_hi_max) <= tiny) {
+                sign *= -1;
+            }
+            if (opt.verbose > 0) {
+                amrex::AllPrint() << "column" << tag << ": step = " << step << ", Phi_Bc_hi = " << Phi_Bc_hi
+                                  << ", num_Vapp = " << num_Vapp << ", sign = " << sign << std::endl;
+            }
+            newton_iters = ColumnComputePhi_Rho(phi, P_old[2], rho, e_den, h_den, mask, eps_face, dx, contains_SC, opt.max_newton_iter);
+        }
+
+        if (voltage_sweep == 0 && step == steady_state_step) break;
+        if (voltage_sweep == 1 && Phi_Bc_hi > 0. && Phi_Bc_hi - Phi_Bc_hi_max > tiny) break;
+        if (voltage_sweep == 1 && Phi_Bc_hi < 0. && -Phi_Bc_hi - Phi_Bc_hi_max > tiny) break;
+        if (voltage_sweep == 1 && num_Vapp == num_Vapp_max) break;
+    }
+
+    diagnostics(summary);
+    summary.steps = std::min(step, nsteps);
+
+    if (opt.write_profile == 1) {
+        std::ofstream prof(opt.plot_file + "_profile" + tag + ".csv");
+        prof << "z,mask,Px,Py,Pz,phi,Ez,rho\n" << std::setprecision(10);
+        for (int kz = 0; kz < nz; ++kz) {
+            prof << prob_lo[zdir] + (kz+0.5)*dx[zdir] << "," << static_cast<int>(mask(kz)) << ","
+                 << P_old[0](kz) << "," << P_old[1](kz) << "," << P_old[2](kz) << ","
+                 << phi(kz) << "," << Er(kz) << "," << rho(kz) << "\n";
+        }
+    }
+
+    return summary;
+}
+
+} // namespace
+
+void RunColumnSolver (c_FerroX& rFerroX)
+{
+    BL_PROFILE("RunColumnSolver()");
+
+    Real strt_time = ParallelDescriptor::second();
+
+    auto& rGprop = rFerroX.get_GeometryProperties();
+    auto& prob_lo = rGprop.prob_lo;
+    auto& prob_hi = rGprop.prob_hi;
+    auto& n_cell = rGprop.n_cell;
+
+    // read in inputs file
+    InitializeFerroXNamespace(prob_lo, prob_hi);
+
+    if (Coordinate_Transformation == 1) {
+        amrex::Print() << "Column mode ignores Euler angles and t-phase regions (Coordinate_Transformation = 1)." << "\n";
+    }
+
+    ColumnOptions opt;
+    opt.nz = n_cell[zdir];
+    opt.prob_lo = prob_lo;
+    opt.prob_hi = prob_hi;
+
+    ParmParse pp("column");
+
+    // lateral position of the column, domain center by default
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) opt.position[d] = 0.5*(prob_lo[d] + prob_hi[d]);
+    amrex::Vector<amrex::Real> temp;
+    if (pp.queryarr("position", temp)) {
+        for (int d = 0; d < AMREX_SPACEDIM-1 && d < static_cast<int>(temp.size()); ++d) opt.position[d] = temp[d];
+    }
+
+    opt.plot_file = "column";
+    pp.query("plot_file", opt.plot_file);
+    // < 0 : no time series, 0 : steady states and voltage steps only, > 0 : also every output_int steps
+    opt.output_int = plot_int;
+    pp.query("output_int", opt.output_int);
+    opt.write_profile = 1;
+    pp.query("write_profile", opt.write_profile);
+    opt.max_newton_iter = 50;
+    pp.query("max_newton_iter", opt.max_newton_iter);
+    opt.verbose = 0;
+    pp.query("verbose", opt.verbose);
+
+    // optional parameter sweep; runs are distributed round-robin across MPI ranks
+    std::string sweep_param;
+    amrex::Vector<amrex::Real> sweep_values;
+    amrex::Real* p_sweep = nullptr;
+    if (pp.query("sweep_param", sweep_param)) {
+        auto table = ColumnSweepParameters();
+        auto it = table.find(sweep_param);
+        if (it == table.end()) {
+            amrex::Abort("column.sweep_param = " + sweep_param + " is not a sweepable parameter");
+        }
+        p_sweep = it->second;
+        pp.getarr("sweep_values", sweep_values);
+    }
+    const int nruns = p_sweep ? static_cast<int>(sweep_values.size()) : 1;
+
+    const amrex::Real Phi_Bc_hi_init = Phi_Bc_hi;
+    const int inc_step_init = inc_step;
+    const amrex::Real sweep_init = p_sweep ? *p_sweep : 0.;
+
+    amrex::Print() << "\n ========= Column mode: " << opt.nz << " cells, " << nruns << " run(s) ========== \n" << std::endl;
+
+    const int nfields = 4;
+    amrex::Vector<amrex::Real> results(nruns*nfields, 0.0);
+
+    const int nprocs = ParallelDescriptor::NProcs();
+    const int myproc = ParallelDescriptor::MyProc();
+
+    for (int run = 0; run < nruns; ++run)
+    {
+        if (run % nprocs != myproc) continue;
+
+        Phi_Bc_hi = Phi_Bc_hi_init;
+        inc_step = inc_step_init;
+        if (p_sweep) *p_sweep = sweep_values[run];
+
+        std::string tag = p_sweep ? amrex::Concatenate("_run", run, 4) : "";
+        ColumnSummary s = RunColumn(opt, tag);
+
+        results[nfields*run+0] = s.Pz_avg;
+        results[nfields*run+1] = s.Q_top;
+        results[nfields*run+2] = s.Phi_Bc_hi;
+        results[nfields*run+3] = s.steps;
+    }
+
+    Phi_Bc_hi = Phi_Bc_hi_init;
+    inc_step = inc_step_init;
+    if (p_sweep) *p_sweep = sweep_init;
+
+    ParallelDescriptor::ReduceRealSum(results.data(), results.size());
+
+    if (ParallelDescriptor::IOProcessor()) {
+        std::ofstream ofs(opt.plot_file + "_summary.csv");
+        ofs << "run," << (p_sweep ? sweep_param : std::string("none")) << ",Pz_avg_FE,Q_top,Phi_Bc_hi,steps\n";
+        ofs << std::setprecision(10);
+        for (int run = 0; run < nruns; ++run) {
+            ofs << run << "," << (p_sweep ? sweep_values[run] : 0.) << ","
+                << results[nfields*run+0] << "," << results[nfields*run+1] << ","
+                << results[nfields*run+2] << "," << static_cast<int>(results[nfields*run+3]) << "\n";
+        }
+    }
+
+    Real stop_time = ParallelDescriptor::second() - strt_time;
+    ParallelDescriptor::ReduceRealMax(stop_time);
+
+    amrex::Print() << "Column mode: " << nruns << " run(s) in " << stop_time << " seconds ("
+                   << nruns/stop_time << " runs/s)\n";
+}
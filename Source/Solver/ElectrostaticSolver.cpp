@@ -3,18 +3,42 @@
 #include "ChargeDensity.H"
 #include "Utils/eXstaticUtils/eXstaticUtil.H"
 #include "Utils/FerroXUtils/FerroXUtil.H"
+#include "Utils/FerroXUtils/PerfCounters.H"
+#include "Utils/FerroXUtils/Telemetry.H"
+
+using FloatMultiFab = amrex::FabArray<amrex::BaseFab<float>>;
+
+// Single-precision correction solver of poisson_mixed_precision = 1, built by SetupMLMG.
+// It has the operator of the double solve with homogeneous Dirichlet data: the
+// correction e of A phi = rhs solves A e = rhs - A phi.
+namespace {
+    struct PoissonCorrectionSolver
+    {
+        std::unique_ptr<amrex::MLABecLaplacianT<FloatMultiFab>> linop;
+        std::unique_ptr<amrex::MLMGT<FloatMultiFab>> mlmg;
+        FloatMultiFab alpha;
+        std::array<FloatMultiFab, AMREX_SPACEDIM> beta;
+        FloatMultiFab res;
+        FloatMultiFab cor;
+        MultiFab res_d;
+    };
+    std::unique_ptr<PoissonCorrectionSolver> correction_solver;
+}
 
 
 void ComputePoissonRHS(MultiFab&               PoissonRHS,
-                Array<MultiFab, AMREX_SPACEDIM> &P_old,
+                Array<MultiFab, 3> &P_old,
                 MultiFab&                       rho,
-                MultiFab&                 MaterialMask,
-                MultiFab& angle_alpha, MultiFab& angle_beta, MultiFab& angle_theta,
+                MaskMultiFab&             MaterialMask,
+                StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
                 const Geometry&                 geom)
 {
-    for ( MFIter mfi(PoissonRHS); mfi.isValid(); ++mfi )
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for ( MFIter mfi(PoissonRHS, TilingIfNotGPU()); mfi.isValid(); ++mfi )
         {
-            const Box& bx = mfi.validbox();
+            const Box& bx = mfi.tilebox();
             // extract dx from the geometry object
             GpuArray<Real,AMREX_SPACEDIM> dx = geom.CellSizeArray();
 
@@ -23,11 +47,11 @@ void ComputePoissonRHS(MultiFab&               PoissonRHS,
             const Array4<Real> &pOld_r = P_old[2].array(mfi);
             const Array4<Real>& RHS = PoissonRHS.array(mfi);
             const Array4<Real>& charge_den_arr = rho.array(mfi);
-            const Array4<Real>& mask = MaterialMask.array(mfi);
+            const Array4<MaskType const>& mask = MaterialMask.array(mfi);
 
-            const Array4<Real> &angle_alpha_arr = angle_alpha.array(mfi);
-            const Array4<Real> &angle_beta_arr = angle_beta.array(mfi);
-            const Array4<Real> &angle_theta_arr = angle_theta.array(mfi);
+            const Array4<StaticReal> &angle_alpha_arr = angle_alpha.array(mfi);
+            const Array4<StaticReal> &angle_beta_arr = angle_beta.array(mfi);
+            const Array4<StaticReal> &angle_theta_arr = angle_theta.array(mfi);
 
             amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
             {
@@ -62,15 +86,15 @@ void ComputePoissonRHS(MultiFab&               PoissonRHS,
                     R_33 = cos(alpha_rad)*cos(beta_rad);
                  }
 
-                 if(mask(i,j,k) >= 2.0){ //SC region
+                 if(mask(i,j,k) >= SC){ //SC region
 
                    RHS(i,j,k) = charge_den_arr(i,j,k);
 
-                 } else if(mask(i,j,k) == 1.0){ //DE region
+                 } else if(mask(i,j,k) == DE){ //DE region
 
                    RHS(i,j,k) = 0.;
 
-                 } else { //mask(i,j,k) == 0.0 FE region
+                 } else { //FE region
                    RHS(i,j,k) = - (R_11*DPDx(pOld_p, mask, i, j, k, dx) + R_12*DPDy(pOld_p, mask, i, j, k, dx) + R_13*DPDz(pOld_p, mask, i, j, k, dx))
                                 - (R_21*DPDx(pOld_q, mask, i, j, k, dx) + R_22*DPDy(pOld_q, mask, i, j, k, dx) + R_23*DPDz(pOld_q, mask, i, j, k, dx))
                                 - (R_31*DPDx(pOld_r, mask, i, j, k, dx) + R_32*DPDy(pOld_r, mask, i, j, k, dx) + R_33*DPDz(pOld_r, mask, i, j, k, dx));
@@ -85,12 +109,12 @@ void ComputePoissonRHS(MultiFab&               PoissonRHS,
 void dF_dPhi(MultiFab&            alpha_cc,
              MultiFab&            PoissonRHS, 
              MultiFab&            PoissonPhi, 
-	     Array<MultiFab, AMREX_SPACEDIM>& P_old,
+	     Array<MultiFab, 3>& P_old,
              MultiFab&            rho,
              MultiFab&            e_den,
              MultiFab&            p_den,
-	     MultiFab&            MaterialMask,
-             MultiFab& angle_alpha, MultiFab& angle_beta, MultiFab& angle_theta,
+	     MaskMultiFab&        MaterialMask,
+             StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
              const          Geometry& geom,
 	     const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_lo,
              const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_hi)
@@ -116,9 +140,12 @@ void ComputePoissonRHS_Newton(MultiFab& PoissonRHS,
                               MultiFab& alpha_cc)
 {
      
-        for ( MFIter mfi(PoissonPhi); mfi.isValid(); ++mfi )
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for ( MFIter mfi(PoissonPhi, TilingIfNotGPU()); mfi.isValid(); ++mfi )
         {
-            const Box& bx = mfi.validbox();
+            const Box& bx = mfi.tilebox();
 
             const Array4<Real>& phi = PoissonPhi.array(mfi);
             const Array4<Real>& poissonRHS = PoissonRHS.array(mfi);
@@ -132,17 +159,25 @@ void ComputePoissonRHS_Newton(MultiFab& PoissonRHS,
 }
 
 void ComputeEfromPhi(MultiFab&                 PoissonPhi,
-                Array<MultiFab, AMREX_SPACEDIM>& E,
-                MultiFab& angle_alpha, MultiFab& angle_beta, MultiFab& angle_theta,
+                Array<MultiFab, 3>& E,
+                StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
                 const Geometry&                 geom,
 		const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_lo, 
 		const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_hi)
 {
-       // Calculate E from Phi
+       FERROX_PROFILE("ComputeEfromPhi()");
 
-        for ( MFIter mfi(PoissonPhi); mfi.isValid(); ++mfi )
+       // Calculate E from Phi; E only has ghost cells with wide_halo, where they are
+       // filled inside the (periodic) domain from the wider PoissonPhi halo
+       const int ngrow = E[0].nGrow();
+       const Box domain = geom.growPeriodicDomain(ngrow);
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+        for ( MFIter mfi(PoissonPhi, TilingIfNotGPU()); mfi.isValid(); ++mfi )
         {
-            const Box& bx = mfi.validbox();
+            const Box bx = mfi.growntilebox(ngrow) & domain;
 
             // extract dx from the geometry object
             GpuArray<Real,AMREX_SPACEDIM> dx = geom.CellSizeArray();
@@ -152,16 +187,13 @@ void ComputeEfromPhi(MultiFab&                 PoissonPhi,
             const Array4<Real>& Er_arr = E[2].array(mfi);
             const Array4<Real>& phi = PoissonPhi.array(mfi);
 
-            const Array4<Real> &angle_alpha_arr = angle_alpha.array(mfi);
-            const Array4<Real> &angle_beta_arr = angle_beta.array(mfi);
-            const Array4<Real> &angle_theta_arr = angle_theta.array(mfi);
+            const Array4<StaticReal> &angle_alpha_arr = angle_alpha.array(mfi);
+            const Array4<StaticReal> &angle_beta_arr = angle_beta.array(mfi);
+            const Array4<StaticReal> &angle_theta_arr = angle_theta.array(mfi);
 
 
             amrex::ParallelFor( bx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
             {
-                     Real z_hi = prob_lo[2] + (k+1.5) * dx[2];
-                     Real z_lo = prob_lo[2] + (k-0.5) * dx[2];
-
                      //Convert Euler angles from degrees to radians
                      amrex::Real Pi = 3.14159265358979323846; 
                      amrex::Real alpha_rad = Pi/180.*angle_alpha_arr(i,j,k);
@@ -192,9 +224,11 @@ void ComputeEfromPhi(MultiFab&                 PoissonPhi,
                         R_33 = cos(alpha_rad)*cos(beta_rad);
                      }
 
-                     Ep_arr(i,j,k) = - (R_11*DFDx(phi, i, j, k, dx) + R_12*DFDy(phi, i, j, k, dx) + R_13*DphiDz(phi, z_hi, z_lo, i, j, k, dx, prob_lo, prob_hi));
-                     Eq_arr(i,j,k) = - (R_21*DFDx(phi, i, j, k, dx) + R_22*DFDy(phi, i, j, k, dx) + R_23*DphiDz(phi, z_hi, z_lo, i, j, k, dx, prob_lo, prob_hi));
-                     Er_arr(i,j,k) = - (R_31*DFDx(phi, i, j, k, dx) + R_32*DFDy(phi, i, j, k, dx) + R_33*DphiDz(phi, z_hi, z_lo, i, j, k, dx, prob_lo, prob_hi));
+                     const auto grad_phi = GradPhi(phi, i, j, k, dx, prob_lo, prob_hi);
+
+                     Ep_arr(i,j,k) = - (R_11*grad_phi[0] + R_12*grad_phi[1] + R_13*grad_phi[2]);
+                     Eq_arr(i,j,k) = - (R_21*grad_phi[0] + R_22*grad_phi[1] + R_23*grad_phi[2]);
+                     Er_arr(i,j,k) = - (R_31*grad_phi[0] + R_32*grad_phi[1] + R_33*grad_phi[2]);
 
 
              });
@@ -204,8 +238,8 @@ void ComputeEfromPhi(MultiFab&                 PoissonPhi,
 
 void InitializePermittivity(std::array<std::array<amrex::LinOpBCType,AMREX_SPACEDIM>,2>& LinOpBCType_2d, 
 		MultiFab& beta_cc,
-	       	const MultiFab& MaterialMask,
-	       	const MultiFab& tphaseMask,
+	       	const MaskMultiFab& MaterialMask,
+	       	const MaskMultiFab& tphaseMask,
 	       	const amrex::GpuArray<int, AMREX_SPACEDIM>& n_cell,
 	       	const Geometry& geom, 
 		const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_lo,
@@ -217,34 +251,29 @@ void InitializePermittivity(std::array<std::array<amrex::LinOpBCType,AMREX_SPACE
     // set cell-centered beta coefficient to
     // epsilon values in SC, FE, and DE layers
     // loop over boxes
-    for (MFIter mfi(beta_cc); mfi.isValid(); ++mfi)
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion())
+#endif
+    for (MFIter mfi(beta_cc, TilingIfNotGPU()); mfi.isValid(); ++mfi)
     {
-        const Box& bx = mfi.validbox();
+        const Box& bx = mfi.tilebox();
 
         const Array4<Real>& beta = beta_cc.array(mfi);
-        const Array4<Real const>& mask = MaterialMask.array(mfi);
-        const Array4<Real const>& tphase = tphaseMask.array(mfi);
-
-	// extract dx from the geometry object
-        GpuArray<Real,AMREX_SPACEDIM> dx = geom.CellSizeArray();
+        const Array4<MaskType const>& mask = MaterialMask.array(mfi);
+        const Array4<MaskType const>& tphase = tphaseMask.array(mfi);
 
         amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k)
         {
-
-	  Real x = prob_lo[0] + (i+0.5) * dx[0];
-	  Real y = prob_lo[1] + (j+0.5) * dx[1];
-	  Real z = prob_lo[1] + (k+0.5) * dx[2];
-	
-          if(mask(i,j,k) == 0.0) {
+          if(mask(i,j,k) == FE) {
              beta(i,j,k) = epsilonX_fe * epsilon_0; //FE layer
 	     //set t_phase beta to epsilonX_fe_tphase
 	     //if(x <= t_phase_hi[0] && x >= t_phase_lo[0] && y <= t_phase_hi[1] && y >= t_phase_lo[1] && z <= t_phase_hi[2] && z >= t_phase_lo[2]){
-	     if(tphase(i,j,k) == 1.0){
+	     if(tphase(i,j,k) == 1){
                beta(i,j,k) = epsilonX_fe_tphase * epsilon_0;
              }
-          } else if(mask(i,j,k) == 1.0) {
+          } else if(mask(i,j,k) == DE) {
              beta(i,j,k) = epsilon_de * epsilon_0; //DE layer
-          } else if (mask(i,j,k) >= 2.0){
+          } else if (mask(i,j,k) >= SC){
              beta(i,j,k) = epsilon_si * epsilon_0; //SC layer
           } else {
              beta(i,j,k) = epsilon_de * epsilon_0; //Spacer is same as DE
@@ -252,7 +281,7 @@ void InitializePermittivity(std::array<std::array<amrex::LinOpBCType,AMREX_SPACE
 
         });
     }
-    beta_cc.FillBoundary(geom.periodicity()); //For Periodic BC and internal domain decomposition
+    FerroX_Perf::FillBoundary(beta_cc, geom.periodicity()); //For Periodic BC and internal domain decomposition
 
     //For Non-periodic Poisson BC, fill the ghost cells with the value in the adjacent cell in valid domain
     for (MFIter mfi(beta_cc); mfi.isValid(); ++mfi)
@@ -284,6 +313,7 @@ void InitializePermittivity(std::array<std::array<amrex::LinOpBCType,AMREX_SPACE
 		     beta(i,j,k) = beta(i,j-1,k);
 		   }
 		}
+#if (AMREX_SPACEDIM == 3)
 	        if (LinOpBCType_2d[0][2] == amrex::LinOpBCType::Dirichlet || LinOpBCType_2d[0][2] == amrex::LinOpBCType::Neumann ){
   		   if(k < 0) {
 		     beta(i,j,k) = beta(i,j,k+1);
@@ -294,6 +324,7 @@ void InitializePermittivity(std::array<std::array<amrex::LinOpBCType,AMREX_SPACE
 		     beta(i,j,k) = beta(i,j,k-1);
 		   }
 		}
+#endif
         });
     }
 }
@@ -500,50 +531,98 @@ void Fill_FunctionBased_Inhomogeneous_Boundaries(c_FerroX& rFerroX, MultiFab& Po
 }
 
 void SetPhiBC_z(MultiFab& PoissonPhi, const amrex::GpuArray<int, AMREX_SPACEDIM>& n_cell, const Geometry& geom)
+{
+    SetPhiBC_z_Ghosts(PoissonPhi, n_cell[zdir]);
+    FerroX_Perf::FillBoundary(PoissonPhi, geom.periodicity());
+}
+
+// potential on the top contact: the applied voltage, shifted by the metal work function if used
+AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+static amrex::Real PhiContact_hi ()
+{
+    amrex::Real Eg = bandgap;
+    amrex::Real Chi = affinity;
+    amrex::Real phi_ref = Chi + 0.5*Eg + 0.5*kb*T*log(Nc/Nv)/q;  
+    amrex::Real phi_m = use_work_function ? metal_work_function : phi_ref; //in eV When not used, applied voltgae is set as the potential on the metal interface 
+    return Phi_Bc_hi - (phi_m - phi_ref);
+}
+
+void SetPhiBC_z_Ghosts(MultiFab& PoissonPhi, int nz)
 {
     for (MFIter mfi(PoissonPhi); mfi.isValid(); ++mfi)
     {
-        const Box& bx = mfi.growntilebox(1);
+        const Box& bx = mfi.growntilebox(PoissonPhi.nGrow());
 
         const Array4<Real>& Phi = PoissonPhi.array(mfi);
 
         amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k)
         {
-          if(k < 0) {
+          const int kz = (AMREX_SPACEDIM == 3) ? k : j; // stack index
+          if(kz < 0) {
             Phi(i,j,k) = Phi_Bc_lo;
-          } else if(k >= n_cell[2]){
-            amrex::Real Eg = bandgap;
-            amrex::Real Chi = affinity;
-            amrex::Real phi_ref = Chi + 0.5*Eg + 0.5*kb*T*log(Nc/Nv)/q;  
-            amrex::Real phi_m = use_work_function ? metal_work_function : phi_ref; //in eV When not used, applied voltgae is set as the potential on the metal interface 
-            Phi(i,j,k) = Phi_Bc_hi - (phi_m - phi_ref);
+          } else if(kz >= nz){
+            Phi(i,j,k) = PhiContact_hi();
+          }
+        });
+    }
+}
+
+void SetPhiBC_z_Solved(MultiFab& PoissonPhi, int nz)
+{
+    for (MFIter mfi(PoissonPhi); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.growntilebox(PoissonPhi.nGrow());
+
+        const Array4<Real>& Phi = PoissonPhi.array(mfi);
+
+        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k)
+        {
+          const int kz = (AMREX_SPACEDIM == 3) ? k : j; // stack index
+          // MLMG's second-order Dirichlet fill: line through the contact value on the face
+          // and the adjacent valid cell, evaluated at the ghost cell center
+          if(kz < 0) {
+            Phi(i,j,k) = 2.*Phi_Bc_lo - ((AMREX_SPACEDIM == 3) ? Phi(i,j,0) : Phi(i,0,k));
+          } else if(kz >= nz){
+            Phi(i,j,k) = 2.*PhiContact_hi() - ((AMREX_SPACEDIM == 3) ? Phi(i,j,nz-1) : Phi(i,nz-1,k));
           }
         });
     }
-    PoissonPhi.FillBoundary(geom.periodicity());
 }
 
 void CheckSteadyState(MultiFab& PoissonPhi, MultiFab& PoissonPhi_Old, MultiFab& Phidiff, Real phi_tolerance, int step, int& steady_state_step, int& inc_step)
 {
+        FERROX_PROFILE("CheckSteadyState()");
 
         Real phi_max = PoissonPhi_Old.norm0();
 
-        for (MFIter mfi(PoissonPhi); mfi.isValid(); ++mfi)
+        // Phidiff is only allocated when it is plotted; the max is reduced directly
+        const bool store_diff = Phidiff.ok();
+
+        ReduceOps<ReduceOpMax> reduce_op;
+        ReduceData<Real> reduce_data(reduce_op);
+        using ReduceTuple = typename decltype(reduce_data)::Type;
+
+        for (MFIter mfi(PoissonPhi, TilingIfNotGPU()); mfi.isValid(); ++mfi)
         {   
-            const Box& bx = mfi.growntilebox(1);
+            const Box& bx = mfi.tilebox();
 
             const Array4<Real>& Phi = PoissonPhi.array(mfi);
             const Array4<Real>& PhiOld = PoissonPhi_Old.array(mfi);
-            const Array4<Real>& Phi_err = Phidiff.array(mfi);
-
+            const Array4<Real>& Phi_err = store_diff ? Phidiff.array(mfi) : Array4<Real>();
 
-            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE(int i, int j, int k)
+            reduce_op.eval(bx, reduce_data,
+            [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
             {   
-                Phi_err(i,j,k) = amrex::Math::abs(Phi(i,j,k) - PhiOld(i,j,k)) / phi_max;
+                Real err = amrex::Math::abs(Phi(i,j,k) - PhiOld(i,j,k)) / phi_max;
+                if (store_diff) Phi_err(i,j,k) = err;
+                //Copy PoissonPhi to PoissonPhi_Old to calculate difference at the next iteration
+                PhiOld(i,j,k) = Phi(i,j,k);
+                return {err};
             }); 
         }   
  
-        Real max_phi_err = Phidiff.norm0();
+        Real max_phi_err = amrex::get<0>(reduce_data.value(reduce_op));
+        ParallelDescriptor::ReduceRealMax(max_phi_err);
 
         if(step > 1){
           if (max_phi_err < phi_tolerance) {
@@ -552,10 +631,9 @@ void CheckSteadyState(MultiFab& PoissonPhi, MultiFab& PoissonPhi_Old, MultiFab&
           }
         }
 
-        //Copy PoissonPhi to PoissonPhi_Old to calculate difference at the next iteration
-        MultiFab::Copy(PoissonPhi_Old, PoissonPhi, 0, 0, 1, 0);
-
-        amrex::Print() << "Steady state check : (phi(t) - phi(t-1)).norm0() = " << max_phi_err << std::endl;
+        if (FerroX_Telemetry::Verbose()) {
+            amrex::Print() << "Steady state check : (phi(t) - phi(t-1)).norm0() = " << max_phi_err << std::endl;
+        }
 
 }
 
@@ -566,6 +644,8 @@ void SetupMLMG(std::unique_ptr<amrex::MLMG>& pMLMG,
         std::array< MultiFab, AMREX_SPACEDIM >& beta_face,
         c_FerroX& rFerroX, MultiFab& PoissonPhi, amrex::Real& time, amrex::LPInfo& info)
  {
+    FERROX_PROFILE("SetupMLMG()");
+
     auto& rGprop = rFerroX.get_GeometryProperties();
     auto& geom = rGprop.geom;
     auto& ba = rGprop.ba;
@@ -594,7 +674,7 @@ void SetupMLMG(std::unique_ptr<amrex::MLMG>& pMLMG,
     {
         Fill_FunctionBased_Inhomogeneous_Boundaries(rFerroX, PoissonPhi, time);
     }
-    PoissonPhi.FillBoundary(geom.periodicity());
+    FerroX_Perf::FillBoundary(PoissonPhi, geom.periodicity());
 
     // set Dirichlet BC by reading in the ghost cell values
     SetPhiBC_z(PoissonPhi, n_cell, geom); 
@@ -608,6 +688,39 @@ void SetupMLMG(std::unique_ptr<amrex::MLMG>& pMLMG,
     pMLMG = std::make_unique<MLMG>(*p_mlabec);
     pMLMG->setVerbose(mlmg_verbosity);
 
+    if (poisson_mixed_precision == 1) {
+        if (poisson_inner_tol < 1.e-5 || poisson_inner_tol >= 1.) {
+            amrex::Abort("poisson_inner_tol must be in [1e-5, 1) with poisson_mixed_precision = 1");
+        }
+        if (!correction_solver) {
+            // the FabArrays must be freed before AMReX shuts down
+            amrex::ExecOnFinalize([] () { correction_solver.reset(); });
+        }
+        correction_solver = std::make_unique<PoissonCorrectionSolver>();
+        auto& cs = *correction_solver;
+
+        cs.linop = std::make_unique<amrex::MLABecLaplacianT<FloatMultiFab>>();
+        cs.linop->define({geom}, {ba}, {dm}, info);
+        cs.linop->setEnforceSingularSolvable(false);
+        cs.linop->setMaxOrder(linop_maxorder);
+        cs.linop->setDomainBC(LinOpBCType_2d[0], LinOpBCType_2d[1]);
+        cs.linop->setLevelBC(amrlev, static_cast<FloatMultiFab const*>(nullptr));
+        cs.linop->setScalars(-1.0f, 1.0f);
+
+        cs.alpha.define(ba, dm, 1, 0);
+        cs.res.define(ba, dm, 1, 0);
+        cs.cor.define(ba, dm, 1, 1);
+        cs.res_d.define(ba, dm, 1, 0);
+        for (int idim = 0; idim < AMREX_SPACEDIM; ++idim) {
+            cs.beta[idim].define(beta_face[idim].boxArray(), dm, 1, 0);
+            amrex::Copy(cs.beta[idim], beta_face[idim], 0, 0, 1, 0);
+        }
+        cs.linop->setBCoeffs(amrlev, amrex::GetArrOfConstPtrs(cs.beta));
+
+        cs.mlmg = std::make_unique<amrex::MLMGT<FloatMultiFab>>(*cs.linop);
+        cs.mlmg->setVerbose(amrex::max(mlmg_verbosity-1, 0));
+    }
+
  }
 
 #ifdef AMREX_USE_EB
@@ -619,6 +732,8 @@ void SetupMLMG(std::unique_ptr<amrex::MLMG>& pMLMG,
         MultiFab& beta_cc,
         c_FerroX& rFerroX, MultiFab& PoissonPhi, amrex::Real& time, amrex::LPInfo& info)
  {
+    FERROX_PROFILE("SetupMLMG()");
+
     auto& rGprop = rFerroX.get_GeometryProperties();
     auto& geom = rGprop.geom;
     auto& ba = rGprop.ba;
@@ -629,6 +744,10 @@ void SetupMLMG(std::unique_ptr<amrex::MLMG>& pMLMG,
     bool some_constant_inhomogeneous_boundaries = false;
     int amrlev = 0; //refers to the setcoarsest level of the solve
 
+    if (poisson_mixed_precision == 1) {
+        amrex::Abort("poisson_mixed_precision = 1 is not available in EB builds");
+    }
+
     p_mlebabec = std::make_unique<amrex::MLEBABecLap>();
     p_mlebabec->define({geom}, {ba}, {dm}, info,{& *rGprop.pEB->p_factory_union});
 
@@ -649,7 +768,7 @@ void SetupMLMG(std::unique_ptr<amrex::MLMG>& pMLMG,
     {
         Fill_FunctionBased_Inhomogeneous_Boundaries(rFerroX, PoissonPhi, time);
     }
-    PoissonPhi.FillBoundary(geom.periodicity());
+    FerroX_Perf::FillBoundary(PoissonPhi, geom.periodicity());
 
     // Set Dirichlet BC for Phi in z
     SetPhiBC_z(PoissonPhi, n_cell, geom); 
@@ -675,32 +794,183 @@ void SetupMLMG(std::unique_ptr<amrex::MLMG>& pMLMG,
  }
 #endif
 
+// Relative L1 change |phi - phi_prev|_1 / |phi|_1 in one pass; overwrites PoissonPhi_Prev with phi
+static Real PhiNewtonChange (const MultiFab& PoissonPhi, MultiFab& PoissonPhi_Prev)
+{
+    ReduceOps<ReduceOpSum, ReduceOpSum> reduce_op;
+    ReduceData<Real, Real> reduce_data(reduce_op);
+    using ReduceTuple = typename decltype(reduce_data)::Type;
+
+    for (MFIter mfi(PoissonPhi, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const Array4<Real const>& phi = PoissonPhi.const_array(mfi);
+        const Array4<Real>& phi_prev = PoissonPhi_Prev.array(mfi);
+
+        reduce_op.eval(bx, reduce_data,
+        [=] AMREX_GPU_DEVICE (int i, int j, int k) -> ReduceTuple
+        {
+            Real diff = amrex::Math::abs(phi(i,j,k) - phi_prev(i,j,k));
+            phi_prev(i,j,k) = phi(i,j,k);
+            return {diff, amrex::Math::abs(phi(i,j,k))};
+        });
+    }
+
+    auto hv = reduce_data.value(reduce_op);
+    Real sums[2] = {amrex::get<0>(hv), amrex::get<1>(hv)};
+    ParallelDescriptor::ReduceRealSum(sums, 2);
+
+    return sums[0]/sums[1];
+}
+
+// Poisson solve counters of one self-consistent solve
+struct PoissonSolveStats
+{
+    int n_solves = 0;
+    int n_vcycles = 0;
+    int n_corrections = 0;
+    Real solve_time = 0.;
+};
+
+// Solves A phi = rhs to 1e-10 relative to the initial residual, from phi = 0.
+// Direct: one double-precision MLMG solve. Mixed precision: iterative refinement, in which the
+// residual r = rhs - A phi is computed in double, A e = r is solved in single precision to
+// poisson_inner_tol and phi += e, until |r| <= 1e-10 |r_0| as in the direct solve.
+static void PoissonSolveStep (std::unique_ptr<amrex::MLMG>& pMLMG,
+                              MultiFab& PoissonPhi, MultiFab& PoissonRHS,
+                              const MultiFab& alpha_cc, PoissonSolveStats& stats)
+{
+    FERROX_PROFILE("MLMG::solve");
+
+    constexpr Real rel_tol = 1.e-10;
+    Real solve_start = ParallelDescriptor::second();
+
+    //Initial guess for phi
+    PoissonPhi.setVal(0.);
+
+    if (poisson_mixed_precision == 0) {
+
+        //Poisson Solve
+        pMLMG->solve({&PoissonPhi}, {&PoissonRHS}, rel_tol, -1);
+
+        stats.n_vcycles += pMLMG->getNumIters();
+        FerroX_Perf::Add(FerroX_Perf::MLMGVCycles, pMLMG->getNumIters());
+
+    } else {
+
+        auto& cs = *correction_solver;
+        amrex::Copy(cs.alpha, alpha_cc, 0, 0, 1, 0);
+        cs.linop->setACoeffs(0, cs.alpha);
+
+        Vector<MultiFab*> res_d{&cs.res_d};
+        Vector<MultiFab*> sol_d{&PoissonPhi};
+        Vector<MultiFab const*> rhs_d{&PoissonRHS};
+        Vector<FloatMultiFab*> cor{&cs.cor};
+        Vector<FloatMultiFab const*> res{&cs.res};
+
+        pMLMG->compResidual(res_d, sol_d, rhs_d);
+        const Real res0 = cs.res_d.norm0();
+        Real res_norm = res0;
+
+        int n = 0;
+        while (res_norm > rel_tol*res0 && n < poisson_max_corrections)
+        {
+            // the residual is scaled to |r| = 1 so that single precision cannot under- or overflow
+            const Real scale = 1./res_norm;
+            for (MFIter mfi(cs.res_d, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+            {
+                const Box& bx = mfi.tilebox();
+                const Array4<Real const>& rd = cs.res_d.const_array(mfi);
+                const Array4<float>& rf = cs.res.array(mfi);
+                amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+                {
+                    rf(i,j,k) = static_cast<float>(rd(i,j,k)*scale);
+                });
+            }
+
+            cs.cor.setVal(0.f);
+            cs.mlmg->solve(cor, res, static_cast<float>(poisson_inner_tol), 0.f);
+            stats.n_vcycles += cs.mlmg->getNumIters();
+            FerroX_Perf::Add(FerroX_Perf::MLMGVCycles, cs.mlmg->getNumIters());
+
+            for (MFIter mfi(PoissonPhi, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+            {
+                const Box& bx = mfi.tilebox();
+                const Array4<Real>& phi = PoissonPhi.array(mfi);
+                const Array4<float const>& e = cs.cor.const_array(mfi);
+                amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+                {
+                    phi(i,j,k) += static_cast<Real>(e(i,j,k))*res_norm;
+                });
+            }
+
+            pMLMG->compResidual(res_d, sol_d, rhs_d);
+            res_norm = cs.res_d.norm0();
+            ++n;
+        }
+        stats.n_corrections += n;
+
+        if (res_norm > rel_tol*res0) {
+            amrex::Print() << "Poisson: iterative refinement stopped after " << n << " corrections at relative residual "
+                           << res_norm/res0 << "; raise poisson_max_corrections or lower poisson_inner_tol\n";
+        }
+    }
+
+    ++stats.n_solves;
+    FerroX_Perf::Add(FerroX_Perf::MLMGSolves, 1);
+
+    // local time; reduced only when it is printed
+    stats.solve_time += ParallelDescriptor::second() - solve_start;
+}
+
+static void PrintPoissonSolveStats (PoissonSolveStats stats)
+{
+    if (mlmg_verbosity >= 1 && FerroX_Telemetry::Verbose()) {
+        ParallelDescriptor::ReduceRealMax(stats.solve_time, ParallelDescriptor::IOProcessorNumber());
+        amrex::Print() << "Poisson (" << ((poisson_mixed_precision == 1) ? "mixed precision" : "double") << "): "
+                       << stats.n_solves << " solves, ";
+        if (poisson_mixed_precision == 1) {
+            amrex::Print() << stats.n_corrections << " corrections, " << stats.n_vcycles << " single-precision V-cycles, ";
+        } else {
+            amrex::Print() << stats.n_vcycles << " V-cycles, ";
+        }
+        amrex::Print() << stats.solve_time << " seconds\n";
+    }
+}
+
 void ComputePhi_Rho(std::unique_ptr<amrex::MLMG>& pMLMG, 
              std::unique_ptr<amrex::MLABecLaplacian>& p_mlabec,
              MultiFab&            alpha_cc,
              MultiFab&            PoissonRHS, 
              MultiFab&            PoissonPhi, 
              MultiFab&            PoissonPhi_Prev,
-             MultiFab&            PhiErr,  
-	         Array<MultiFab, AMREX_SPACEDIM>& P_old,
+	         Array<MultiFab, 3>& P_old,
              MultiFab&            rho,
              MultiFab&            e_den,
              MultiFab&            p_den,
-	         MultiFab&            MaterialMask,
-             MultiFab& angle_alpha, MultiFab& angle_beta, MultiFab& angle_theta,
+	         MaskMultiFab&        MaterialMask,
+             StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
              const          Geometry& geom,
 	         const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_lo,
              const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_hi)
 
 {
+    FERROX_PROFILE("ComputePhi_Rho()");
+
 //Obtain self consisten Phi and rho
     Real tol = 1.e-5;
     Real err = 1.0;
     int iter = 0;
     bool contains_SC = false;
     FerroX_Util::Contains_sc(MaterialMask, contains_SC);
+
+    int n_iters = 0;
+    PoissonSolveStats stats;
     
     while(err > tol){
+        FERROX_PROFILE("ComputePhi_Rho::NewtonIteration");
+        FerroX_Perf::Add(FerroX_Perf::NewtonIterations, 1);
+        ++n_iters;
    
 	//Compute RHS of Poisson equation
 	ComputePoissonRHS(PoissonRHS, P_old, rho, MaterialMask, angle_alpha, angle_beta, angle_theta, geom);
@@ -712,12 +982,11 @@ void ComputePhi_Rho(std::unique_ptr<amrex::MLMG>& pMLMG,
 
         p_mlabec->setACoeffs(0, alpha_cc);
 
-        //Initial guess for phi
-        PoissonPhi.setVal(0.);
-
-        //Poisson Solve
-        pMLMG->solve({&PoissonPhi}, {&PoissonRHS}, 1.e-10, -1);
-	    PoissonPhi.FillBoundary(geom.periodicity());
+        PoissonSolveStep(pMLMG, PoissonPhi, PoissonRHS, alpha_cc, stats);
+	    FerroX_Perf::FillBoundary(PoissonPhi, geom.periodicity());
+        // E and TDGL read the ghost cells below and above the stack; MLMG fills them only when
+        // PoissonPhi has exactly one ghost layer, so set them here for every halo width
+        SetPhiBC_z_Solved(PoissonPhi, geom.Domain().length(zdir));
 	
         // Calculate rho from Phi in SC region
         ComputeRho(PoissonPhi, rho, e_den, p_den, MaterialMask);
@@ -727,21 +996,26 @@ void ComputePhi_Rho(std::unique_ptr<amrex::MLMG>& pMLMG,
             err = 0.;
         } else {
 
-            // Calculate Error
+            // Calculate Error; also copies PoissonPhi to PoissonPhi_Prev for the next iteration
+            Real phi_change = PhiNewtonChange(PoissonPhi, PoissonPhi_Prev);
             if (iter > 0){
-                MultiFab::Copy(PhiErr, PoissonPhi, 0, 0, 1, 0);
-                MultiFab::Subtract(PhiErr, PoissonPhi_Prev, 0, 0, 1, 0);
-                err = PhiErr.norm1(0, geom.periodicity())/PoissonPhi.norm1(0, geom.periodicity());
+                err = phi_change;
             }
 
-            //Copy PoissonPhi to PoissonPhi_Prev to calculate error at the next iteration
-            MultiFab::Copy(PoissonPhi_Prev, PoissonPhi, 0, 0, 1, 0);
-
             iter = iter + 1;
-            amrex::Print() << iter << " iterations :: err = " << err << std::endl;
-            if( iter > 20 ) amrex::Print() <<  "Failed to reach self consistency between Phi and Rho in 20 iterations!! " << std::endl;
+            if (FerroX_Telemetry::VerboseNewton()) {
+                amrex::Print() << iter << " iterations :: err = " << err << std::endl;
+            }
+            if (err > tol && iter >= phi_rho_max_iter) {
+                amrex::Print() << "Failed to reach self consistency between Phi and Rho in " << iter
+                               << " iterations (phi_rho_max_iter), err = " << err << "; continuing with this potential" << std::endl;
+                break;
+            }
         }
     }
+
+    FerroX_Telemetry::AddNewtonIterations(n_iters);
+    PrintPoissonSolveStats(stats);
     
     // amrex::Print() << "\n ========= Self-Consistent Initialization of Phi and Rho Done! ========== \n"<< iter << " iterations to obtain self consistent Phi with err = " << err << std::endl;
 }
@@ -753,26 +1027,33 @@ void ComputePhi_Rho_EB(std::unique_ptr<amrex::MLMG>& pMLMG,
              MultiFab&            PoissonRHS, 
              MultiFab&            PoissonPhi, 
              MultiFab&            PoissonPhi_Prev,
-             MultiFab&            PhiErr,  
-	         Array<MultiFab, AMREX_SPACEDIM>& P_old,
+	         Array<MultiFab, 3>& P_old,
              MultiFab&            rho,
              MultiFab&            e_den,
              MultiFab&            p_den,
-	         MultiFab&            MaterialMask,
-             MultiFab& angle_alpha, MultiFab& angle_beta, MultiFab& angle_theta,
+	         MaskMultiFab&        MaterialMask,
+             StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
              const          Geometry& geom,
 	         const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_lo,
              const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_hi)
 
 {
+    FERROX_PROFILE("ComputePhi_Rho()");
+
 //Obtain self consisten Phi and rho
     Real tol = 1.e-5;
     Real err = 1.0;
     int iter = 0;
     bool contains_SC = false;
     FerroX_Util::Contains_sc(MaterialMask, contains_SC);
+
+    int n_iters = 0;
+    PoissonSolveStats stats;
     
     while(err > tol){
+        FERROX_PROFILE("ComputePhi_Rho::NewtonIteration");
+        FerroX_Perf::Add(FerroX_Perf::NewtonIterations, 1);
+        ++n_iters;
    
 	//Compute RHS of Poisson equation
 	ComputePoissonRHS(PoissonRHS, P_old, rho, MaterialMask, angle_alpha, angle_beta, angle_theta, geom);
@@ -784,12 +1065,11 @@ void ComputePhi_Rho_EB(std::unique_ptr<amrex::MLMG>& pMLMG,
 
         p_mlebabec->setACoeffs(0, alpha_cc);
 
-        //Initial guess for phi
-        PoissonPhi.setVal(0.);
-
-        //Poisson Solve
-        pMLMG->solve({&PoissonPhi}, {&PoissonRHS}, 1.e-10, -1);
-	    PoissonPhi.FillBoundary(geom.periodicity());
+        PoissonSolveStep(pMLMG, PoissonPhi, PoissonRHS, alpha_cc, stats);
+	    FerroX_Perf::FillBoundary(PoissonPhi, geom.periodicity());
+        // E and TDGL read the ghost cells below and above the stack; MLMG fills them only when
+        // PoissonPhi has exactly one ghost layer, so set them here for every halo width
+        SetPhiBC_z_Solved(PoissonPhi, geom.Domain().length(zdir));
 	
         // Calculate rho from Phi in SC region
         ComputeRho(PoissonPhi, rho, e_den, p_den, MaterialMask);
@@ -799,21 +1079,26 @@ void ComputePhi_Rho_EB(std::unique_ptr<amrex::MLMG>& pMLMG,
             err = 0.;
         } else {
 
-            // Calculate Error
+            // Calculate Error; also copies PoissonPhi to PoissonPhi_Prev for the next iteration
+            Real phi_change = PhiNewtonChange(PoissonPhi, PoissonPhi_Prev);
             if (iter > 0){
-                MultiFab::Copy(PhiErr, PoissonPhi, 0, 0, 1, 0);
-                MultiFab::Subtract(PhiErr, PoissonPhi_Prev, 0, 0, 1, 0);
-                err = PhiErr.norm1(0, geom.periodicity())/PoissonPhi.norm1(0, geom.periodicity());
+                err = phi_change;
             }
 
-            //Copy PoissonPhi to PoissonPhi_Prev to calculate error at the next iteration
-            MultiFab::Copy(PoissonPhi_Prev, PoissonPhi, 0, 0, 1, 0);
-
             iter = iter + 1;
-            amrex::Print() << iter << " iterations :: err = " << err << std::endl;
-            if( iter > 20 ) amrex::Print() <<  "Failed to reach self consistency between Phi and Rho in 20 iterations!! " << std::endl;
+            if (FerroX_Telemetry::VerboseNewton()) {
+                amrex::Print() << iter << " iterations :: err = " << err << std::endl;
+            }
+            if (err > tol && iter >= phi_rho_max_iter) {
+                amrex::Print() << "Failed to reach self consistency between Phi and Rho in " << iter
+                               << " iterations (phi_rho_max_iter), err = " << err << "; continuing with this potential" << std::endl;
+                break;
+            }
         }
     }
+
+    FerroX_Telemetry::AddNewtonIterations(n_iters);
+    PrintPoissonSolveStats(stats);
     
     // amrex::Print() << "\n ========= Self-Consistent Initialization of Phi and Rho Done! ========== \n"<< iter << " iterations to obtain self consistent Phi with err = " << err << std::endl;
 }
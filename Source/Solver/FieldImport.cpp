@@ -0,0 +1,227 @@
+#include "FieldImport.H"
+
+#include <AMReX_ParmParse.H>
+#include <AMReX_VisMF.H>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+namespace {
+
+struct ImportRegion
+{
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> lo;
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> hi;
+};
+
+// Index in the file of the cell whose centre is nearest to grid cell i in direction d
+int FileIndex (int i, int d, int n_file, const Geometry& geom, const ImportRegion& region)
+{
+    const amrex::Real x = geom.ProbLo(d) + (i+0.5)*geom.CellSize(d);
+    const amrex::Real fdx = (region.hi[d]-region.lo[d])/n_file;
+    const int s = static_cast<int>(std::floor((x-region.lo[d])/fdx));
+    return amrex::max(0, amrex::min(n_file-1, s));
+}
+
+// File-index boxes under each grid box, with the same ordering as the grid BoxArray
+BoxArray MapToFile (const BoxArray& ba, const IntVect& n_file, const Geometry& geom, const ImportRegion& region)
+{
+    BoxList bl;
+    for (int n = 0; n < ba.size(); ++n) {
+        const Box& bx = ba[n];
+        IntVect lo, hi;
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+            lo[d] = FileIndex(bx.smallEnd(d), d, n_file[d], geom, region);
+            hi[d] = FileIndex(bx.bigEnd(d), d, n_file[d], geom, region);
+        }
+        bl.push_back(Box(lo, hi));
+    }
+    return BoxArray(std::move(bl));
+}
+
+template <typename T>
+amrex::Real LoadValue (const char* p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return static_cast<amrex::Real>(v);
+}
+
+int ElementSize (const std::string& type)
+{
+    if (type == "uint8") return 1;
+    if (type == "int32") return 4;
+    if (type == "float32") return 4;
+    if (type == "float64") return 8;
+    amrex::Abort("import: element type must be uint8, int32, float32 or float64, got " + type);
+    return 0;
+}
+
+// Fill src (file index space) from a raw binary file, one contiguous read per z-plane of each local box
+void ReadRaw (MultiFab& src, const std::string& filename, const std::string& type, const IntVect& n_file)
+{
+    const int es = ElementSize(type);
+    amrex::Real (*load)(const char*) = (type == "uint8")   ? &LoadValue<std::uint8_t>
+                                     : (type == "int32")   ? &LoadValue<std::int32_t>
+                                     : (type == "float32") ? &LoadValue<float>
+                                     :                       &LoadValue<double>;
+    const Long nx = n_file[0];
+    const Long ny = (AMREX_SPACEDIM > 1) ? n_file[1] : 1;
+    Long ntotal = 1;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) ntotal *= n_file[d];
+
+    std::ifstream ifs(filename, std::ios::binary);
+    if (!ifs.good()) amrex::Abort("import: cannot open " + filename);
+    ifs.seekg(0, std::ios::end);
+    if (static_cast<Long>(ifs.tellg()) != ntotal*es) {
+        amrex::Abort("import: size of " + filename + " does not match import.n_cell and " + type);
+    }
+
+    Vector<char> buffer;
+    for (MFIter mfi(src); mfi.isValid(); ++mfi)
+    {
+        const auto& arr = src.array(mfi);
+        const auto lo = amrex::lbound(mfi.validbox());
+        const auto hi = amrex::ubound(mfi.validbox());
+
+        for (int k = lo.z; k <= hi.z; ++k) {
+            const Long first = lo.x + nx*(lo.y + ny*k);
+            const Long last  = hi.x + nx*(hi.y + ny*k);
+            buffer.resize((last-first+1)*es);
+            ifs.seekg(first*es, std::ios::beg);
+            ifs.read(buffer.data(), buffer.size());
+            if (!ifs.good()) amrex::Abort("import: read error in " + filename);
+
+            for (int j = lo.y; j <= hi.y; ++j) {
+                for (int i = lo.x; i <= hi.x; ++i) {
+                    arr(i,j,k) = load(buffer.data() + ((i + nx*(j + ny*k)) - first)*es);
+                }
+            }
+        }
+    }
+}
+
+// Nearest-neighbour resampling of src (file index space) into dst
+template <typename T>
+void Resample (const MultiFab& src, FabArray<BaseFab<T>>& dst, const IntVect& n_file,
+               const Geometry& geom, const ImportRegion& region)
+{
+    const auto dx = geom.CellSizeArray();
+    const auto prob_lo = geom.ProbLoArray();
+    const auto region_lo = region.lo;
+    const auto region_hi = region.hi;
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> fdx;
+    amrex::GpuArray<int, AMREX_SPACEDIM> nf;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        fdx[d] = (region.hi[d]-region.lo[d])/n_file[d];
+        nf[d] = n_file[d];
+    }
+
+    for (MFIter mfi(dst, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.tilebox();
+        const auto& src_arr = src.const_array(mfi);
+        const auto& dst_arr = dst.array(mfi);
+
+        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            const int idx[3] = {i, j, k};
+            int s[3] = {0, 0, 0};
+            for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+                const amrex::Real x = prob_lo[d] + (idx[d]+0.5)*dx[d];
+                if (x < region_lo[d] || x > region_hi[d]) return;
+                s[d] = amrex::max(0, amrex::min(nf[d]-1, static_cast<int>(std::floor((x-region_lo[d])/fdx[d]))));
+            }
+            const amrex::Real v = src_arr(s[0],s[1],s[2]);
+            if constexpr (std::is_integral<T>::value) {
+                dst_arr(i,j,k) = static_cast<T>(std::floor(v+0.5));
+            } else {
+                dst_arr(i,j,k) = static_cast<T>(v);
+            }
+        });
+    }
+}
+
+} // namespace
+
+bool ImportMicrostructure (const Geometry& geom,
+                           MaskMultiFab& MaterialMask, MaskMultiFab& tphaseMask,
+                           StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta)
+{
+    BL_PROFILE("ImportMicrostructure()");
+
+    ParmParse pp("import");
+
+    std::string format = "raw";
+    pp.query("format", format);
+    if (format != "raw" && format != "vismf") amrex::Abort("import.format must be raw or vismf");
+
+    ImportRegion region;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        region.lo[d] = geom.ProbLo(d);
+        region.hi[d] = geom.ProbHi(d);
+    }
+    amrex::Vector<amrex::Real> temp;
+    if (pp.queryarr("lo", temp)) {
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) region.lo[d] = temp[d];
+    }
+    if (pp.queryarr("hi", temp)) {
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) region.hi[d] = temp[d];
+    }
+
+    bool imported = false;
+
+    auto import_field = [&] (const std::string& field, auto& dst, const std::string& default_type)
+    {
+        std::string filename;
+        if (!pp.query((field + "_file").c_str(), filename)) return;
+
+        Real t0 = ParallelDescriptor::second();
+
+        IntVect n_file;
+        MultiFab filemf;
+        int comp = 0;
+        if (format == "raw") {
+            amrex::Vector<int> nc;
+            pp.getarr("n_cell", nc);
+            for (int d = 0; d < AMREX_SPACEDIM; ++d) n_file[d] = nc[d];
+        } else {
+            pp.query((field + "_comp").c_str(), comp);
+            VisMF::Read(filemf, filename);
+            n_file = filemf.boxArray().minimalBox().length();
+        }
+
+        // staging buffer in file index space, distributed like dst so each rank only touches its own part
+        const BoxArray src_ba = MapToFile(dst.boxArray(), n_file, geom, region);
+        MultiFab src(src_ba, dst.DistributionMap(), 1, 0, MFInfo().SetArena(The_Pinned_Arena()));
+
+        if (format == "raw") {
+            std::string type = default_type;
+            pp.query((field + "_type").c_str(), type);
+            ReadRaw(src, filename, type, n_file);
+        } else {
+            src.ParallelCopy(filemf, comp, 0, 1);
+            filemf.clear();
+        }
+
+        Resample(src, dst, n_file, geom, region);
+        dst.FillBoundary(geom.periodicity());
+        imported = true;
+
+        Real t = ParallelDescriptor::second() - t0;
+        ParallelDescriptor::ReduceRealMax(t, ParallelDescriptor::IOProcessorNumber());
+        amrex::Print() << "Imported " << field << " from " << filename << " ("
+                       << AMREX_D_TERM(n_file[0], << " x " << n_file[1], << " x " << n_file[2])
+                       << ") in " << t << " s\n";
+    };
+
+    import_field("mask", MaterialMask, "uint8");
+    import_field("tphase", tphaseMask, "uint8");
+    import_field("alpha", angle_alpha, "float32");
+    import_field("beta", angle_beta, "float32");
+    import_field("theta", angle_theta, "float32");
+
+    return imported;
+}
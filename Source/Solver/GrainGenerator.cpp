@@ -0,0 +1,282 @@
+#include "GrainGenerator.H"
+
+#include <AMReX_ParmParse.H>
+#include <AMReX_GpuContainers.H>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace {
+
+struct GrainInputs
+{
+    int num_grains = 0;
+    int seed = 1;
+    std::string distribution = "uniform";
+    std::string orientation = "random";
+    amrex::Real tphase_fraction = 0.;
+    amrex::GpuArray<amrex::Real, 3> angle_mean = {0., 0., 0.}; // alpha, beta, theta in degrees
+    amrex::GpuArray<amrex::Real, 3> angle_std  = {0., 0., 0.};
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> lo;
+    amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> hi;
+};
+
+GrainInputs ReadGrainInputs ()
+{
+    GrainInputs in;
+    ParmParse pp("grains");
+
+    pp.get("num_grains", in.num_grains);
+    if (in.num_grains < 1) amrex::Abort("grains.num_grains must be positive");
+
+    in.seed = random_seed;
+    pp.query("seed", in.seed);
+
+    pp.query("distribution", in.distribution);
+    if (in.distribution != "uniform" && in.distribution != "columnar") {
+        amrex::Abort("grains.distribution must be uniform or columnar");
+    }
+
+    pp.query("orientation", in.orientation);
+    if (in.orientation != "random" && in.orientation != "gaussian" && in.orientation != "fixed") {
+        amrex::Abort("grains.orientation must be random, gaussian or fixed");
+    }
+
+    const char* names[3] = {"alpha", "beta", "theta"};
+    for (int n = 0; n < 3; ++n) {
+        pp.query((std::string(names[n]) + "_mean").c_str(), in.angle_mean[n]);
+        pp.query((std::string(names[n]) + "_std").c_str(), in.angle_std[n]);
+    }
+
+    pp.query("tphase_fraction", in.tphase_fraction);
+
+    // grains fill the FE region unless a region is given
+    in.lo = FE_lo;
+    in.hi = FE_hi;
+    amrex::Vector<amrex::Real> temp;
+    if (pp.queryarr("lo", temp)) {
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) in.lo[d] = temp[d];
+    }
+    if (pp.queryarr("hi", temp)) {
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) in.hi[d] = temp[d];
+    }
+    return in;
+}
+
+} // namespace
+
+void InitializeGrains (c_FerroX& /*rFerroX*/, const Geometry& geom,
+                       MaskMultiFab& tphaseMask,
+                       StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
+                       iMultiFab* GrainID)
+{
+    BL_PROFILE("InitializeGrains()");
+
+    const GrainInputs in = ReadGrainInputs();
+    const int ngrains = in.num_grains;
+
+    // dimensions that enter the nearest-seed distance; columnar grains ignore the stack direction.
+    // Everything below is padded to 3 directions, unused ones have a single bucket.
+    amrex::GpuArray<int, 3> active = {0, 0, 0};
+    amrex::GpuArray<amrex::Real, 3> lo = {0., 0., 0.};
+    amrex::GpuArray<amrex::Real, 3> len = {0., 0., 0.};
+    int nactive = 0;
+    amrex::Real volume = 1.;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        lo[d] = in.lo[d];
+        len[d] = in.hi[d] - in.lo[d];
+        if (len[d] <= 0.) amrex::Abort("grains.hi must be larger than grains.lo");
+        active[d] = (in.distribution == "columnar" && d == zdir) ? 0 : 1;
+        if (active[d]) {
+            ++nactive;
+            volume *= len[d];
+        }
+    }
+
+    // bucket grid with about one seed per bucket
+    const amrex::Real h = std::pow(volume/ngrains, 1./nactive);
+    amrex::GpuArray<int, 3> nb = {1, 1, 1};
+    amrex::GpuArray<amrex::Real, 3> bw = {1., 1., 1.};
+    amrex::Real bw_min = std::numeric_limits<amrex::Real>::max();
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        if (active[d]) {
+            nb[d] = std::max(1, static_cast<int>(len[d]/h));
+            bw[d] = len[d]/nb[d];
+            bw_min = std::min(bw_min, bw[d]);
+        }
+    }
+    const int nbuckets = nb[0]*nb[1]*nb[2];
+    const int max_ring = std::max({nb[0], nb[1], nb[2]});
+
+    // seeds and per-grain properties, identical on every rank
+    amrex::Vector<amrex::Real> h_sx(ngrains, 0.), h_sy(ngrains, 0.), h_sz(ngrains, 0.);
+    amrex::Vector<amrex::Real> h_alpha(ngrains), h_beta(ngrains), h_theta(ngrains);
+    amrex::Vector<int> h_tphase(ngrains, 0);
+    {
+        std::mt19937_64 gen(static_cast<std::uint64_t>(in.seed));
+        std::uniform_real_distribution<amrex::Real> uniform(0., 1.);
+        std::normal_distribution<amrex::Real> normal(0., 1.);
+        const amrex::Real Pi = 3.14159265358979323846;
+
+        amrex::Real* s[3] = {h_sx.data(), h_sy.data(), h_sz.data()};
+        for (int g = 0; g < ngrains; ++g) {
+            for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+                s[d][g] = lo[d] + len[d]*uniform(gen);
+            }
+            if (in.orientation == "random") {
+                // uniformly distributed orientations
+                h_alpha[g] = 360.*uniform(gen);
+                h_beta[g]  = std::acos(1. - 2.*uniform(gen))*180./Pi;
+                h_theta[g] = 360.*uniform(gen);
+            } else if (in.orientation == "gaussian") {
+                h_alpha[g] = in.angle_mean[0] + in.angle_std[0]*normal(gen);
+                h_beta[g]  = in.angle_mean[1] + in.angle_std[1]*normal(gen);
+                h_theta[g] = in.angle_mean[2] + in.angle_std[2]*normal(gen);
+            } else {
+                h_alpha[g] = in.angle_mean[0];
+                h_beta[g]  = in.angle_mean[1];
+                h_theta[g] = in.angle_mean[2];
+            }
+            h_tphase[g] = (uniform(gen) < in.tphase_fraction) ? 1 : 0;
+        }
+    }
+
+    // bucket the seeds (CSR layout: seeds of bucket b are bucket_seeds[bucket_start[b]..bucket_start[b+1]))
+    amrex::Vector<int> h_bucket_start(nbuckets+1, 0), h_bucket_seeds(ngrains);
+    {
+        amrex::Vector<int> seed_bucket(ngrains);
+        const amrex::Real* s[3] = {h_sx.data(), h_sy.data(), h_sz.data()};
+        for (int g = 0; g < ngrains; ++g) {
+            int b[3] = {0, 0, 0};
+            for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+                if (active[d]) b[d] = amrex::min(nb[d]-1, static_cast<int>((s[d][g]-lo[d])/bw[d]));
+            }
+            seed_bucket[g] = b[0] + nb[0]*(b[1] + nb[1]*b[2]);
+            ++h_bucket_start[seed_bucket[g]+1];
+        }
+        for (int b = 0; b < nbuckets; ++b) h_bucket_start[b+1] += h_bucket_start[b];
+        amrex::Vector<int> fill(h_bucket_start.begin(), h_bucket_start.end()-1);
+        for (int g = 0; g < ngrains; ++g) h_bucket_seeds[fill[seed_bucket[g]]++] = g;
+    }
+
+    auto to_device = [] (auto const& hv, auto& dv)
+    {
+        dv.resize(hv.size());
+        amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, hv.begin(), hv.end(), dv.begin());
+    };
+    amrex::Gpu::DeviceVector<amrex::Real> d_sx, d_sy, d_sz, d_alpha, d_beta, d_theta;
+    amrex::Gpu::DeviceVector<int> d_tphase, d_bucket_start, d_bucket_seeds;
+    to_device(h_sx, d_sx); to_device(h_sy, d_sy); to_device(h_sz, d_sz);
+    to_device(h_alpha, d_alpha); to_device(h_beta, d_beta); to_device(h_theta, d_theta);
+    to_device(h_tphase, d_tphase);
+    to_device(h_bucket_start, d_bucket_start); to_device(h_bucket_seeds, d_bucket_seeds);
+    amrex::Gpu::streamSynchronize();
+
+    const amrex::Real* sx = d_sx.data();
+    const amrex::Real* sy = d_sy.data();
+    const amrex::Real* sz = d_sz.data();
+    const amrex::Real* g_alpha = d_alpha.data();
+    const amrex::Real* g_beta  = d_beta.data();
+    const amrex::Real* g_theta = d_theta.data();
+    const int* g_tphase = d_tphase.data();
+    const int* bucket_start = d_bucket_start.data();
+    const int* bucket_seeds = d_bucket_seeds.data();
+
+    const auto dx = geom.CellSizeArray();
+    const auto prob_lo = geom.ProbLoArray();
+    const auto region_lo = in.lo;
+    const auto region_hi = in.hi;
+    const bool store_id = (GrainID != nullptr);
+
+    // ghost cells too, as the parser path fills the masks; tphaseMask has the widest halo
+    // and each field is written where its own fab reaches
+    for (MFIter mfi(tphaseMask, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const Box& bx = mfi.growntilebox();
+
+        const auto& alpha_arr = angle_alpha.array(mfi);
+        const auto& beta_arr = angle_beta.array(mfi);
+        const auto& theta_arr = angle_theta.array(mfi);
+        const auto& tphase_arr = tphaseMask.array(mfi);
+        const auto& id_arr = store_id ? GrainID->array(mfi) : Array4<int>();
+
+        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+        {
+            amrex::Real pos[3] = {AMREX_D_DECL(prob_lo[0] + (i+0.5)*dx[0],
+                                               prob_lo[1] + (j+0.5)*dx[1],
+                                               prob_lo[2] + (k+0.5)*dx[2])};
+            bool inside = true;
+            for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+                inside = inside && pos[d] >= region_lo[d] && pos[d] <= region_hi[d];
+            }
+            // cells outside the grain region are not ferroelectric grains: angles 0, not t-phase
+            if (!inside) {
+                if (alpha_arr.contains(i,j,k)) alpha_arr(i,j,k) = 0;
+                if (beta_arr.contains(i,j,k))  beta_arr(i,j,k)  = 0;
+                if (theta_arr.contains(i,j,k)) theta_arr(i,j,k) = 0;
+                tphase_arr(i,j,k) = 0;
+                if (store_id && id_arr.contains(i,j,k)) id_arr(i,j,k) = -1;
+                return;
+            }
+
+            int b[3] = {0, 0, 0};
+            for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+                if (active[d]) b[d] = amrex::max(0, amrex::min(nb[d]-1, static_cast<int>((pos[d]-lo[d])/bw[d])));
+            }
+
+            // search rings of buckets around b until no closer seed can exist
+            int best = -1;
+            amrex::Real best_d2 = std::numeric_limits<amrex::Real>::max();
+            for (int r = 0; r <= max_ring; ++r) {
+                int blo[3], bhi[3];
+                for (int d = 0; d < 3; ++d) {
+                    blo[d] = amrex::max(0, b[d]-r);
+                    bhi[d] = amrex::min(nb[d]-1, b[d]+r);
+                }
+                for (int bk = blo[2]; bk <= bhi[2]; ++bk) {
+                for (int bj = blo[1]; bj <= bhi[1]; ++bj) {
+                for (int bi = blo[0]; bi <= bhi[0]; ++bi) {
+                    int ring = amrex::max(amrex::Math::abs(bi-b[0]),
+                               amrex::max(amrex::Math::abs(bj-b[1]), amrex::Math::abs(bk-b[2])));
+                    if (ring != r) continue;
+                    const int bucket = bi + nb[0]*(bj + nb[1]*bk);
+                    for (int n = bucket_start[bucket]; n < bucket_start[bucket+1]; ++n) {
+                        const int g = bucket_seeds[n];
+                        amrex::Real d2 = 0.;
+                        if (active[0]) d2 += (pos[0]-sx[g])*(pos[0]-sx[g]);
+                        if (active[1]) d2 += (pos[1]-sy[g])*(pos[1]-sy[g]);
+                        if (active[2]) d2 += (pos[2]-sz[g])*(pos[2]-sz[g]);
+                        if (d2 < best_d2 || (d2 == best_d2 && g < best)) {
+                            best_d2 = d2;
+                            best = g;
+                        }
+                    }
+                }
+                }
+                }
+                // every bucket in ring r+1 is at least r*bw_min away
+                if (best >= 0 && best_d2 <= (r*bw_min)*(r*bw_min)) break;
+            }
+
+            if (alpha_arr.contains(i,j,k)) alpha_arr(i,j,k) = static_cast<StaticReal>(g_alpha[best]);
+            if (beta_arr.contains(i,j,k))  beta_arr(i,j,k)  = static_cast<StaticReal>(g_beta[best]);
+            if (theta_arr.contains(i,j,k)) theta_arr(i,j,k) = static_cast<StaticReal>(g_theta[best]);
+            tphase_arr(i,j,k) = static_cast<MaskType>(g_tphase[best]);
+            if (store_id && id_arr.contains(i,j,k)) id_arr(i,j,k) = best;
+        });
+    }
+
+    angle_alpha.FillBoundary(geom.periodicity());
+    angle_beta.FillBoundary(geom.periodicity());
+    angle_theta.FillBoundary(geom.periodicity());
+    tphaseMask.FillBoundary(geom.periodicity());
+
+    int n_tphase = 0;
+    for (int g = 0; g < ngrains; ++g) n_tphase += h_tphase[g];
+    amrex::Print() << "Grain generator: " << ngrains << " " << in.distribution << " grains ("
+                   << n_tphase << " t-phase), " << in.orientation << " orientations, "
+                   << nb[0] << " x " << nb[1] << " x " << nb[2] << " buckets\n";
+}
@@ -1,16 +1,30 @@
 #include "Initialization.H"
 #include "Utils/eXstaticUtils/eXstaticUtil.H"
+#include "Utils/FerroXUtils/FerroXRandom.H"
+#include "Utils/FerroXUtils/BoxSumFunction.H"
 #include "../../Utils/SelectWarpXUtils/WarpXUtil.H"
 
+// true if the cell center pos lies inside the [lo,hi] box of a material region
+AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+static bool IsInsideRegion (amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& pos,
+                            amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& lo,
+                            amrex::GpuArray<amrex::Real, AMREX_SPACEDIM> const& hi)
+{
+    bool inside = true;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        inside = inside && (pos[d] >= lo[d]) && (pos[d] <= hi[d]);
+    }
+    return inside;
+}
+
 // INITIALIZE rho in SC region
-void InitializePandRho(Array<MultiFab, AMREX_SPACEDIM> &P_old,
-                   MultiFab&   Gamma,
+void InitializePandRho(Array<MultiFab, 3> &P_old,
+                   StaticMultiFab& Gamma,
                    MultiFab&   rho,
                    MultiFab&   e_den,
                    MultiFab&   p_den,
-		   const MultiFab& MaterialMask,
-		   const MultiFab& tphaseMask,
-                   const amrex::GpuArray<int, AMREX_SPACEDIM>& n_cell,
+		   const MaskMultiFab& MaterialMask,
+		   const MaskMultiFab& tphaseMask,
                    const       Geometry& geom,
 		   const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_lo,
                    const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_hi)
@@ -42,25 +56,10 @@ void InitializePandRho(Array<MultiFab, AMREX_SPACEDIM> &P_old,
       amrex::Abort();
     }
 
-    // Read this from inputs file. Default seed = 1
-    int seed = random_seed;
-
-    int nprocs = ParallelDescriptor::NProcs();
-
-    if (prob_type == 1) {
-       amrex::InitRandom(seed                             , nprocs, seed                             );  // give all MPI ranks the same seed
-    } else { 
-      amrex::InitRandom(seed+ParallelDescriptor::MyProc(), nprocs, seed+ParallelDescriptor::MyProc());  // give all MPI ranks a different seed
-    }
-
-    int nrand = n_cell[0]*n_cell[2];
-    amrex::Gpu::ManagedVector<Real> rngs(nrand, 0.0);
-
-    // generate random numbers on the host
-    for (int i=0; i<nrand; ++i) {
-        //rngs[i] = amrex::RandomNormal(0.,1.); // zero mean, unit variance
-         rngs[i] = amrex::Random(); // uniform [0,1] option
-    }
+    // Read this from inputs file. Default seed = 1.
+    // Random P comes from a counter-based generator keyed on the seed and the global
+    // cell index, so it does not depend on the number of ranks or the box layout.
+    const std::uint64_t seed = static_cast<std::uint64_t>(random_seed);
 
     // loop over boxes
     for (MFIter mfi(rho); mfi.isValid(); ++mfi)
@@ -73,36 +72,45 @@ void InitializePandRho(Array<MultiFab, AMREX_SPACEDIM> &P_old,
         const Array4<Real> &pOld_p = P_old[0].array(mfi);
         const Array4<Real> &pOld_q = P_old[1].array(mfi);
         const Array4<Real> &pOld_r = P_old[2].array(mfi);
-        const Array4<Real>& Gam = Gamma.array(mfi);
-        const Array4<Real const>& mask = MaterialMask.array(mfi);
-        const Array4<Real const>& tphase = tphaseMask.array(mfi);
-
-        Real* rng = rngs.data();
+        const Array4<StaticReal>& Gam = Gamma.array(mfi);
+        const Array4<MaskType const>& mask = MaterialMask.array(mfi);
+        const Array4<MaskType const>& tphase = tphaseMask.array(mfi);
 
         // set P
-        amrex::ParallelForRNG(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k, amrex::RandomEngine const& engine) noexcept
+        amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
         {
             Real x = prob_lo[0] + (i+0.5) * dx[0];
+#if (AMREX_SPACEDIM == 3)
             Real y = prob_lo[1] + (j+0.5) * dx[1];
             Real z = prob_lo[2] + (k+0.5) * dx[2];
-            if (mask(i,j,k) == 0.0) { //FE mask is 0.0
+            const int kz = k;
+#else
+            Real y = 0.0; // x-z plane
+            Real z = prob_lo[1] + (j+0.5) * dx[1];
+            const int kz = j;
+#endif
+            if (mask(i,j,k) == FE) {
                if (prob_type == 1) {  //2D : Initialize uniform P in y direction
 
-                 pOld_p(i,j,k) = (-1.0 + 2.0*rng[i + k*n_cell[2]])*Remnant_P[0];
-                 pOld_q(i,j,k) = (-1.0 + 2.0*rng[i + k*n_cell[2]])*Remnant_P[1];
-                 pOld_r(i,j,k) = (-1.0 + 2.0*rng[i + k*n_cell[2]])*Remnant_P[2];
+                 // one number per (x,z) column, shared by all components
+                 const Real rx = FerroX_Random::CellUniform(i, kz, 0, 1, seed);
+                 pOld_p(i,j,k) = (-1.0 + 2.0*rx)*Remnant_P[0];
+                 pOld_q(i,j,k) = (-1.0 + 2.0*rx)*Remnant_P[1];
+                 pOld_r(i,j,k) = (-1.0 + 2.0*rx)*Remnant_P[2];
 
                } else if (prob_type == 2) { // 3D : Initialize random P
 
-                 pOld_p(i,j,k) = (-1.0 + 2.0*Random(engine))*Remnant_P[0];
-                 pOld_q(i,j,k) = (-1.0 + 2.0*Random(engine))*Remnant_P[1];
-                 pOld_r(i,j,k) = (-1.0 + 2.0*Random(engine))*Remnant_P[2];
+                 Real rx, ry, rz;
+                 FerroX_Random::CellUniform3(i, j, k, 0, seed, rx, ry, rz);
+                 pOld_p(i,j,k) = (-1.0 + 2.0*rx)*Remnant_P[0];
+                 pOld_q(i,j,k) = (-1.0 + 2.0*ry)*Remnant_P[1];
+                 pOld_r(i,j,k) = (-1.0 + 2.0*rz)*Remnant_P[2];
 
                } else if (prob_type == 3) { // smooth P for convergence tests
 
-                 pOld_p(i,j,k) = Remnant_P[0]*exp(-(x*x/(2.0*5.e-9*5.e-9) + y*y/(2.0*5.e-9*5.e-9) + (z-1.5*DE_hi[2])*(z - 1.5*DE_hi[2])/(2.0*2.0e-9*2.0e-9)));
-                 pOld_q(i,j,k) = Remnant_P[1]*exp(-(x*x/(2.0*5.e-9*5.e-9) + y*y/(2.0*5.e-9*5.e-9) + (z-1.5*DE_hi[2])*(z - 1.5*DE_hi[2])/(2.0*2.0e-9*2.0e-9)));
-                 pOld_r(i,j,k) = Remnant_P[2]*exp(-(x*x/(2.0*5.e-9*5.e-9) + y*y/(2.0*5.e-9*5.e-9) + (z-1.5*DE_hi[2])*(z - 1.5*DE_hi[2])/(2.0*2.0e-9*2.0e-9)));
+                 pOld_p(i,j,k) = Remnant_P[0]*exp(-(x*x/(2.0*5.e-9*5.e-9) + y*y/(2.0*5.e-9*5.e-9) + (z-1.5*DE_hi[zdir])*(z - 1.5*DE_hi[zdir])/(2.0*2.0e-9*2.0e-9)));
+                 pOld_q(i,j,k) = Remnant_P[1]*exp(-(x*x/(2.0*5.e-9*5.e-9) + y*y/(2.0*5.e-9*5.e-9) + (z-1.5*DE_hi[zdir])*(z - 1.5*DE_hi[zdir])/(2.0*2.0e-9*2.0e-9)));
+                 pOld_r(i,j,k) = Remnant_P[2]*exp(-(x*x/(2.0*5.e-9*5.e-9) + y*y/(2.0*5.e-9*5.e-9) + (z-1.5*DE_hi[zdir])*(z - 1.5*DE_hi[zdir])/(2.0*2.0e-9*2.0e-9)));
 
                } else {
 
@@ -114,7 +122,7 @@ void InitializePandRho(Array<MultiFab, AMREX_SPACEDIM> &P_old,
 
 	       //set t_phase Pz to zero
 	       //if(x <= t_phase_hi[0] && x >= t_phase_lo[0] && y <= t_phase_hi[1] && y >= t_phase_lo[1] && z <= t_phase_hi[2] && z >= t_phase_lo[2]){
-	       if(tphase(i,j,k) == 1.0){
+	       if(tphase(i,j,k) == 1){
                  pOld_r(i,j,k) = 0.0;
 	       }
 
@@ -146,7 +154,7 @@ void InitializePandRho(Array<MultiFab, AMREX_SPACEDIM> &P_old,
         {
 
              //SC region
-             if (mask(i,j,k) >= 2.0) {
+             if (mask(i,j,k) >= SC) {
 
                 hole_den_arr(i,j,k) = intrinsic_carrier_concentration;
                 e_den_arr(i,j,k) = intrinsic_carrier_concentration;
@@ -162,11 +170,13 @@ void InitializePandRho(Array<MultiFab, AMREX_SPACEDIM> &P_old,
       // fill periodic ghost cells
       P_old[i].FillBoundary(geom.periodicity());
     }
+    // Gamma is read in the ghost cells computed with wide_halo
+    Gamma.FillBoundary(geom.periodicity());
 
  }
 
 // create a mask filled with integers to idetify different material types
-void InitializeMaterialMask(MultiFab& MaterialMask, 
+void InitializeMaterialMask(MaskMultiFab& MaterialMask, 
 		            const Geometry& geom, 
 			    const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_lo,
                             const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_hi)
@@ -178,205 +188,108 @@ void InitializeMaterialMask(MultiFab& MaterialMask,
         // extract dx from the geometry object
         GpuArray<Real,AMREX_SPACEDIM> dx = geom.CellSizeArray();
 
-        const Array4<Real>& mask = MaterialMask.array(mfi);
+        const Array4<MaskType>& mask = MaterialMask.array(mfi);
 
 
         amrex::ParallelFor( bx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
         {
-             Real x = prob_lo[0] + (i+0.5) * dx[0];
-             Real y = prob_lo[1] + (j+0.5) * dx[1];
-             Real z = prob_lo[2] + (k+0.5) * dx[2];
+             GpuArray<Real,AMREX_SPACEDIM> pos = {AMREX_D_DECL(prob_lo[0] + (i+0.5) * dx[0],
+                                                               prob_lo[1] + (j+0.5) * dx[1],
+                                                               prob_lo[2] + (k+0.5) * dx[2])};
 
              //FE:0, DE:1, Source/Drain:2, Channel:3
-             if (x <= FE_hi[0] && x >= FE_lo[0] && y <= FE_hi[1] && y >= FE_lo[1] && z <= FE_hi[2] && z >= FE_lo[2]) {
-                 mask(i,j,k) = 0.;
-             } else if (x <= DE_hi[0] && x >= DE_lo[0] && y <= DE_hi[1] && y >= DE_lo[1] && z <= DE_hi[2] && z >= DE_lo[2]) {
-                 mask(i,j,k) = 1.;
-             } else if (x <= SC_hi[0] && x >= SC_lo[0] && y <= SC_hi[1] && y >= SC_lo[1] && z <= SC_hi[2] && z >= SC_lo[2]) {
-                 mask(i,j,k) = 2.;
-                if (x <= Channel_hi[0] && x >= Channel_lo[0] && y <= Channel_hi[1] && y >= Channel_lo[1] && z <= Channel_hi[2] && z >= Channel_lo[2]){
-                    mask(i,j,k) = 3.;
+             if (IsInsideRegion(pos, FE_lo, FE_hi)) {
+                 mask(i,j,k) = FE;
+             } else if (IsInsideRegion(pos, DE_lo, DE_hi)) {
+                 mask(i,j,k) = DE;
+             } else if (IsInsideRegion(pos, SC_lo, SC_hi)) {
+                 mask(i,j,k) = SC;
+                if (IsInsideRegion(pos, Channel_lo, Channel_hi)){
+                    mask(i,j,k) = Channel;
                 }
              } else {
-	         mask(i,j,k) = 1.; //spacer is DE
+	         mask(i,j,k) = DE; //spacer is DE
 	     }
         });
     }
     MaterialMask.FillBoundary(geom.periodicity());
 }
 
-// initialization of mask (device geometry) with parser
-void InitializeMaterialMask(c_FerroX& rFerroX, const Geometry& geom, MultiFab& MaterialMask)
-{ 
-    auto& rGprop = rFerroX.get_GeometryProperties();
-    Box const& domain = rGprop.geom.Domain();
-
-    const auto dx = rGprop.geom.CellSizeArray();
-    const auto& real_box = rGprop.geom.ProbDomain();
-    const auto iv = MaterialMask.ixType().toIntVect();
-
-    for (MFIter mfi(MaterialMask, TilingIfNotGPU()); mfi.isValid(); ++mfi)
-    {
-        const auto& mask_arr = MaterialMask.array(mfi);
-        const auto& bx = mfi.tilebox();
-
-	std::string m_mask_s;
-	std::unique_ptr<amrex::Parser> m_mask_parser;
-        std::string m_str_device_geom_function;
-
-	ParmParse pp_mask("device_geom");
-
+// Read prefix.key (which may be split over several lines) and fill mf with it on
+// growntilebox(ngrow). Sums of constant boxes, the usual form of polycrystalline
+// decks, go through BoxSumFunction so that every cell only tests the boxes that
+// reach its tile; anything else is parsed and compiled once per rank, outside
+// the MFIter loop, by amrex::Parser.
+template <class T>
+static void FillFromFunction (const std::string& prefix, const std::string& key, const Geometry& geom,
+                              FabArray<BaseFab<T>>& mf, int ngrow)
+{
+    ParmParse pp(prefix);
+    if (!pp.contains(key.c_str())) {
+        amrex::Abort("Initialization: " + prefix + "." + key + " must be specified");
+    }
+    std::string function_str;
+    Store_parserString(pp, key, function_str);
+
+    BoxSumFunction box_sum;
+    if (box_sum.Parse(function_str)) {
+        amrex::Print() << prefix << "." << key << ": " << box_sum.size() << " box terms, box-sum evaluator\n";
+        box_sum.Fill(mf, ngrow, geom);
+        return;
+    }
 
-	if (pp_mask.query("device_geom_function(x,y,z)", m_str_device_geom_function) ) {
-            m_mask_s = "parse_device_geom_function";
-        }
+    const auto dx = geom.CellSizeArray();
+    const auto& real_box = geom.ProbDomain();
+    const auto iv = mf.ixType().toIntVect();
 
-        if (m_mask_s == "parse_device_geom_function") {
-            Store_parserString(pp_mask, "device_geom_function(x,y,z)", m_str_device_geom_function);
-            m_mask_parser = std::make_unique<amrex::Parser>(
-                                     makeParser(m_str_device_geom_function,{"x","y","z"}));
-        }
+    auto mask_parser = makeParser(function_str,{"x","y","z"});
+    const auto& macro_parser = mask_parser.compile<3>();
 
-        const auto& macro_parser = m_mask_parser->compile<3>();
+    for (MFIter mfi(mf, TilingIfNotGPU()); mfi.isValid(); ++mfi)
+    {
+        const auto& mf_arr = mf.array(mfi);
+        const auto& bx = mfi.growntilebox(ngrow);
 
         amrex::ParallelFor(bx,
         [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
         {
-            eXstatic_MFab_Util::ConvertParserIntoMultiFab_3vars(i,j,k,dx,real_box,iv,macro_parser,mask_arr);
+            eXstatic_MFab_Util::ConvertParserIntoMultiFab_3vars(i,j,k,dx,real_box,iv,macro_parser,mf_arr);
         });
-
     }
-	MaterialMask.FillBoundary(geom.periodicity());
 }
 
-// initialization of t-phase mask with parser
-void Initialize_tphase_Mask(c_FerroX& rFerroX, const Geometry& geom, MultiFab& tphaseMask)
+// initialization of mask (device geometry) with parser
+void InitializeMaterialMask(c_FerroX& rFerroX, const Geometry& geom, MaskMultiFab& MaterialMask)
 { 
     auto& rGprop = rFerroX.get_GeometryProperties();
-    Box const& domain = rGprop.geom.Domain();
-
-    const auto dx = rGprop.geom.CellSizeArray();
-    const auto& real_box = rGprop.geom.ProbDomain();
-    const auto iv = tphaseMask.ixType().toIntVect();
-
-    for (MFIter mfi(tphaseMask, TilingIfNotGPU()); mfi.isValid(); ++mfi)
-    {
-        const auto& mask_arr = tphaseMask.array(mfi);
-        const auto& bx = mfi.tilebox();
-
-	std::string tphase_mask_s;
-	std::unique_ptr<amrex::Parser> tphase_mask_parser;
-        std::string m_str_tphase_geom_function;
-
-	ParmParse pp_mask("tphase_geom");
-
 
-	if (pp_mask.query("tphase_geom_function(x,y,z)", m_str_tphase_geom_function) ) {
-            tphase_mask_s = "parse_tphase_geom_function";
-        }
+    // ghost cells too, so that cells outside the domain have the same type on every rank
+    FillFromFunction("device_geom", "device_geom_function(x,y,z)", rGprop.geom, MaterialMask, MaterialMask.nGrow());
 
-        if (tphase_mask_s == "parse_tphase_geom_function") {
-            Store_parserString(pp_mask, "tphase_geom_function(x,y,z)", m_str_tphase_geom_function);
-            tphase_mask_parser = std::make_unique<amrex::Parser>(
-                                     makeParser(m_str_tphase_geom_function,{"x","y","z"}));
-        }
+	MaterialMask.FillBoundary(geom.periodicity());
+}
 
-        const auto& macro_parser = tphase_mask_parser->compile<3>();
+// initialization of t-phase mask with parser
+void Initialize_tphase_Mask(c_FerroX& rFerroX, const Geometry& geom, MaskMultiFab& tphaseMask)
+{ 
+    auto& rGprop = rFerroX.get_GeometryProperties();
 
-        amrex::ParallelFor(bx,
-        [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-        {
-            eXstatic_MFab_Util::ConvertParserIntoMultiFab_3vars(i,j,k,dx,real_box,iv,macro_parser,mask_arr);
-        });
+    // ghost cells too, so that cells outside the domain have the same type on every rank
+    FillFromFunction("tphase_geom", "tphase_geom_function(x,y,z)", rGprop.geom, tphaseMask, tphaseMask.nGrow());
 
-    }
 	tphaseMask.FillBoundary(geom.periodicity());
 }
 
 
 // initialization of Euler angles
-void Initialize_Euler_angles(c_FerroX& rFerroX, const Geometry& geom, MultiFab& angle_alpha, MultiFab& angle_beta, MultiFab& angle_theta)
+void Initialize_Euler_angles(c_FerroX& rFerroX, const Geometry& geom, StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta)
 { 
     auto& rGprop = rFerroX.get_GeometryProperties();
-    Box const& domain = rGprop.geom.Domain();
-
-    const auto dx = rGprop.geom.CellSizeArray();
-    const auto& real_box = rGprop.geom.ProbDomain();
-    const auto iv_alpha = angle_alpha.ixType().toIntVect();
-    const auto iv_beta = angle_beta.ixType().toIntVect();
-    const auto iv_theta = angle_theta.ixType().toIntVect();
-
-    for (MFIter mfi(angle_alpha, TilingIfNotGPU()); mfi.isValid(); ++mfi)
-    {
-        const auto& alpha_arr = angle_alpha.array(mfi);
-        const auto& beta_arr = angle_beta.array(mfi);
-        const auto& theta_arr = angle_theta.array(mfi);
-        const auto& bx = mfi.tilebox();
-
-	std::string alpha_s;
-	std::unique_ptr<amrex::Parser> alpha_parser;
-        std::string m_str_alpha_function;
-
-	std::string beta_s;
-	std::unique_ptr<amrex::Parser> beta_parser;
-        std::string m_str_beta_function;
-
-	std::string theta_s;
-	std::unique_ptr<amrex::Parser> theta_parser;
-        std::string m_str_theta_function;
-
-	ParmParse pp_alpha("angle_alpha");
 
+    FillFromFunction("angle_alpha", "alpha_function(x,y,z)", rGprop.geom, angle_alpha, 0);
+    FillFromFunction("angle_beta",  "beta_function(x,y,z)",  rGprop.geom, angle_beta,  0);
+    FillFromFunction("angle_theta", "theta_function(x,y,z)", rGprop.geom, angle_theta, 0);
 
-	if (pp_alpha.query("alpha_function(x,y,z)", m_str_alpha_function) ) {
-            alpha_s = "parse_alpha_function";
-        }
-
-        if (alpha_s == "parse_alpha_function") {
-            Store_parserString(pp_alpha, "alpha_function(x,y,z)", m_str_alpha_function);
-            alpha_parser = std::make_unique<amrex::Parser>(
-                                     makeParser(m_str_alpha_function,{"x","y","z"}));
-        }
-
-	ParmParse pp_beta("angle_beta");
-
-
-	if (pp_beta.query("beta_function(x,y,z)", m_str_beta_function) ) {
-            beta_s = "parse_beta_function";
-        }
-
-        if (beta_s == "parse_beta_function") {
-            Store_parserString(pp_beta, "beta_function(x,y,z)", m_str_beta_function);
-            beta_parser = std::make_unique<amrex::Parser>(
-                                     makeParser(m_str_beta_function,{"x","y","z"}));
-        }
-
-	ParmParse pp_theta("angle_theta");
-
-
-	if (pp_theta.query("theta_function(x,y,z)", m_str_theta_function) ) {
-            theta_s = "parse_theta_function";
-        }
-
-        if (theta_s == "parse_theta_function") {
-            Store_parserString(pp_theta, "theta_function(x,y,z)", m_str_theta_function);
-            theta_parser = std::make_unique<amrex::Parser>(
-                                     makeParser(m_str_theta_function,{"x","y","z"}));
-        }
-
-        const auto& macro_parser_alpha = alpha_parser->compile<3>();
-        const auto& macro_parser_beta = beta_parser->compile<3>();
-        const auto& macro_parser_theta = theta_parser->compile<3>();
-
-        amrex::ParallelFor(bx,
-        [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
-        {
-            eXstatic_MFab_Util::ConvertParserIntoMultiFab_3vars(i,j,k,dx,real_box,iv_alpha,macro_parser_alpha,alpha_arr);
-            eXstatic_MFab_Util::ConvertParserIntoMultiFab_3vars(i,j,k,dx,real_box,iv_beta, macro_parser_beta, beta_arr );
-            eXstatic_MFab_Util::ConvertParserIntoMultiFab_3vars(i,j,k,dx,real_box,iv_theta,macro_parser_theta,theta_arr);
-        });
-
-    }
 	angle_alpha.FillBoundary(geom.periodicity());
 	angle_beta.FillBoundary(geom.periodicity());
 	angle_theta.FillBoundary(geom.periodicity());
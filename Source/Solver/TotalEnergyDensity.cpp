@@ -1,23 +1,39 @@
 #include "TotalEnergyDensity.H"
 #include "DerivativeAlgorithm.H"
 #include "AMReX_CONSTANTS.H"
+#include "Utils/FerroXUtils/PerfCounters.H"
 
 
-void CalculateTDGL_RHS(Array<MultiFab, AMREX_SPACEDIM> &GL_rhs,
-                Array<MultiFab, AMREX_SPACEDIM> &P_old,
-                Array<MultiFab, AMREX_SPACEDIM> &E,
-                MultiFab&                       Gamma,
-                MultiFab&                 MaterialMask,
-                MultiFab&                 tphaseMask,
-                MultiFab& angle_alpha, MultiFab& angle_beta, MultiFab& angle_theta,
+void CalculateTDGL_RHS(Array<MultiFab, 3> &GL_rhs,
+                Array<MultiFab, 3> &P_old,
+                Array<MultiFab, 3> &E,
+                MultiFab&                       PoissonPhi,
+                StaticMultiFab&                 Gamma,
+                MaskMultiFab&             MaterialMask,
+                MaskMultiFab&             tphaseMask,
+                StaticMultiFab& angle_alpha, StaticMultiFab& angle_beta, StaticMultiFab& angle_theta,
                 const Geometry& geom,
 		const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_lo,
-                const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_hi)
+                const amrex::GpuArray<amrex::Real, AMREX_SPACEDIM>& prob_hi,
+                int ngrow)
 {
-        // loop over boxes
-        for ( MFIter mfi(P_old[0]); mfi.isValid(); ++mfi )
+        FERROX_PROFILE("CalculateTDGL_RHS()");
+
+        // with ngrow > 0 (wide_halo) the first ngrow ghost layers inside the (periodic) domain are
+        // computed too; P_old, the masks, Gamma, the angles, E and PoissonPhi must then have
+        // their ghost cells filled out to the stencil reach beyond that
+        const Box domain = geom.growPeriodicDomain(ngrow);
+
+        Long cells_updated = 0;
+
+        // loop over tiles; the tiling and thread schedule are those of FerroX_Util::FirstTouch
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (Gpu::notInLaunchRegion()) reduction(+:cells_updated)
+#endif
+        for ( MFIter mfi(P_old[0], TilingIfNotGPU()); mfi.isValid(); ++mfi )
         {
-            const Box& bx = mfi.validbox();
+            const Box bx = mfi.growntilebox(ngrow) & domain;
+            cells_updated += bx.numPts();
 
             // extract dx from the geometry object
             GpuArray<Real,AMREX_SPACEDIM> dx = geom.CellSizeArray();
@@ -28,16 +44,19 @@ void CalculateTDGL_RHS(Array<MultiFab, AMREX_SPACEDIM> &GL_rhs,
             const Array4<Real> &pOld_p = P_old[0].array(mfi);
             const Array4<Real> &pOld_q = P_old[1].array(mfi);
             const Array4<Real> &pOld_r = P_old[2].array(mfi);
-            const Array4<Real> &Ep = E[0].array(mfi);
-            const Array4<Real> &Eq = E[1].array(mfi);
-            const Array4<Real> &Er = E[2].array(mfi);
-            const Array4<Real>& Gam = Gamma.array(mfi);
-            const Array4<Real>& mask = MaterialMask.array(mfi);
-            const Array4<Real>& tphase = tphaseMask.array(mfi);
+            // with compute_E_on_the_fly E is not stored and is taken from the potential stencil
+            const bool E_on_the_fly = (compute_E_on_the_fly == 1);
+            const Array4<Real> &Ep = E_on_the_fly ? Array4<Real>() : E[0].array(mfi);
+            const Array4<Real> &Eq = E_on_the_fly ? Array4<Real>() : E[1].array(mfi);
+            const Array4<Real> &Er = E_on_the_fly ? Array4<Real>() : E[2].array(mfi);
+            const Array4<Real> &phi = PoissonPhi.array(mfi);
+            const Array4<StaticReal>& Gam = Gamma.array(mfi);
+            const Array4<MaskType const>& mask = MaterialMask.array(mfi);
+            const Array4<MaskType const>& tphase = tphaseMask.array(mfi);
 
-            const Array4<Real> &angle_alpha_arr = angle_alpha.array(mfi);
-            const Array4<Real> &angle_beta_arr = angle_beta.array(mfi);
-            const Array4<Real> &angle_theta_arr = angle_theta.array(mfi);
+            const Array4<StaticReal> &angle_alpha_arr = angle_alpha.array(mfi);
+            const Array4<StaticReal> &angle_beta_arr = angle_beta.array(mfi);
+            const Array4<StaticReal> &angle_theta_arr = angle_theta.array(mfi);
 
 
             amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k)
@@ -73,29 +92,21 @@ void CalculateTDGL_RHS(Array<MultiFab, AMREX_SPACEDIM> &GL_rhs,
                   R_33 = cos(alpha_rad)*cos(beta_rad);
                }
 
-                Real dFdPp_Landau = alpha*pOld_p(i,j,k) + beta*std::pow(pOld_p(i,j,k),3.) + FerroX::gamma*std::pow(pOld_p(i,j,k),5.)
-                                    + 2. * alpha_12 * pOld_p(i,j,k) * std::pow(pOld_q(i,j,k),2.)
-                                    + 2. * alpha_12 * pOld_p(i,j,k) * std::pow(pOld_r(i,j,k),2.)
-                                    + 4. * alpha_112 * std::pow(pOld_p(i,j,k),3.) * (std::pow(pOld_q(i,j,k),2.) + std::pow(pOld_r(i,j,k),2.))
-                                    + 2. * alpha_112 * pOld_p(i,j,k) * std::pow(pOld_q(i,j,k),4.)
-                                    + 2. * alpha_112 * pOld_p(i,j,k) * std::pow(pOld_r(i,j,k),4.)
-                                    + 2. * alpha_123 * pOld_p(i,j,k) * std::pow(pOld_q(i,j,k),2.) * std::pow(pOld_r(i,j,k),2.);
-
-                Real dFdPq_Landau = alpha*pOld_q(i,j,k) + beta*std::pow(pOld_q(i,j,k),3.) + FerroX::gamma*std::pow(pOld_q(i,j,k),5.)
-                                    + 2. * alpha_12 * pOld_q(i,j,k) * std::pow(pOld_p(i,j,k),2.)
-                                    + 2. * alpha_12 * pOld_q(i,j,k) * std::pow(pOld_r(i,j,k),2.)
-                                    + 4. * alpha_112 * std::pow(pOld_q(i,j,k),3.) * (std::pow(pOld_p(i,j,k),2.) + std::pow(pOld_r(i,j,k),2.))
-                                    + 2. * alpha_112 * pOld_q(i,j,k) * std::pow(pOld_p(i,j,k),4.)
-                                    + 2. * alpha_112 * pOld_q(i,j,k) * std::pow(pOld_r(i,j,k),4.)
-                                    + 2. * alpha_123 * pOld_q(i,j,k) * std::pow(pOld_p(i,j,k),2.) * std::pow(pOld_r(i,j,k),2.);
-                
-                Real dFdPr_Landau = alpha*pOld_r(i,j,k) + beta*std::pow(pOld_r(i,j,k),3.) + FerroX::gamma*std::pow(pOld_r(i,j,k),5.)
-                                    + 2. * alpha_12 * pOld_r(i,j,k) * std::pow(pOld_p(i,j,k),2.)
-                                    + 2. * alpha_12 * pOld_r(i,j,k) * std::pow(pOld_q(i,j,k),2.)
-                                    + 4. * alpha_112 * std::pow(pOld_r(i,j,k),3.) * (std::pow(pOld_p(i,j,k),2.) + std::pow(pOld_q(i,j,k),2.))
-                                    + 2. * alpha_112 * pOld_r(i,j,k) * std::pow(pOld_p(i,j,k),4.)
-                                    + 2. * alpha_112 * pOld_r(i,j,k) * std::pow(pOld_q(i,j,k),4.)
-                                    + 2. * alpha_123 * pOld_r(i,j,k) * std::pow(pOld_p(i,j,k),2.) * std::pow(pOld_q(i,j,k),2.);
+                Real E_p, E_q, E_r;
+                if (E_on_the_fly) {
+                    const auto grad_phi = GradPhi(phi, i, j, k, dx, prob_lo, prob_hi);
+                    E_p = - (R_11*grad_phi[0] + R_12*grad_phi[1] + R_13*grad_phi[2]);
+                    E_q = - (R_21*grad_phi[0] + R_22*grad_phi[1] + R_23*grad_phi[2]);
+                    E_r = - (R_31*grad_phi[0] + R_32*grad_phi[1] + R_33*grad_phi[2]);
+                } else {
+                    E_p = Ep(i,j,k);
+                    E_q = Eq(i,j,k);
+                    E_r = Er(i,j,k);
+                }
+
+                Real dFdPp_Landau = dFdP_Landau(pOld_p(i,j,k), pOld_q(i,j,k), pOld_r(i,j,k));
+                Real dFdPq_Landau = dFdP_Landau(pOld_q(i,j,k), pOld_p(i,j,k), pOld_r(i,j,k));
+                Real dFdPr_Landau = dFdP_Landau(pOld_r(i,j,k), pOld_p(i,j,k), pOld_q(i,j,k));
 
                 Real dFdPp_grad = - g11 * DoubleDPDx(pOld_p, mask, i, j, k, dx)
                                   - (g44 + g44_p) * DoubleDPDy(pOld_p, mask, i, j, k, dx)
@@ -136,19 +147,19 @@ void CalculateTDGL_RHS(Array<MultiFab, AMREX_SPACEDIM> &GL_rhs,
                 GL_RHS_p(i,j,k) = -1.0 * Gam(i,j,k) *
                     (  dFdPp_Landau
                      + dFdPp_grad
-		     - Ep(i,j,k)
+		     - E_p
                     );
 
                 GL_RHS_q(i,j,k) = -1.0 * Gam(i,j,k) *
                     (  dFdPq_Landau
                      + dFdPq_grad
-		     - Eq(i,j,k)
+		     - E_q
                     );
 
                 GL_RHS_r(i,j,k) = -1.0 * Gam(i,j,k) *
                     (  dFdPr_Landau
                      + dFdPr_grad
-		     - Er(i,j,k)
+		     - E_r
                     );
 
                 if (is_polarization_scalar == 1){
@@ -158,13 +169,15 @@ void CalculateTDGL_RHS(Array<MultiFab, AMREX_SPACEDIM> &GL_rhs,
 
 		//set t_phase GL_RHS_r to zero so that it stays zero. It is initialized to zero in t-phase as well
                 //if(x <= t_phase_hi[0] && x >= t_phase_lo[0] && y <= t_phase_hi[1] && y >= t_phase_lo[1] && z <= t_phase_hi[2] && z >= t_phase_lo[2]){
-                if (tphase(i,j,k) == 1.0){
+                if (tphase(i,j,k) == 1){
 		   GL_RHS_p(i,j,k) = 0.0;
 		   GL_RHS_q(i,j,k) = 0.0;
 		   GL_RHS_r(i,j,k) = 0.0;
                 }
             });
         }
+
+        FerroX_Perf::Add(FerroX_Perf::CellsUpdated, cells_updated);
 }
 
 
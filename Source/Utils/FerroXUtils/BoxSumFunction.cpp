@@ -0,0 +1,155 @@
+/*
+ * This file is part of FerroX.
+ *
+ * Contributor: Prabhat Kumar
+ *
+ */
+#include <BoxSumFunction.H>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+using namespace amrex;
+
+namespace {
+
+// the whole of s is one number, as read by strtod
+bool ReadNumber (const std::string& s, Real& val)
+{
+    if (s.empty()) return false;
+    char* end = nullptr;
+    val = std::strtod(s.c_str(), &end);
+    return end == s.c_str() + s.size();
+}
+
+// s[i] is the sign of an exponent, as in 1.e-9
+bool IsExponentSign (const std::string& s, std::size_t i)
+{
+    return i >= 2 && (s[i-1] == 'e' || s[i-1] == 'E')
+                  && (std::isdigit(static_cast<unsigned char>(s[i-2])) || s[i-2] == '.');
+}
+
+} // namespace
+
+bool BoxSumFunction::Parse (const std::string& expr)
+{
+    m_terms.clear();
+
+    std::string s;
+    s.reserve(expr.size());
+    for (char c : expr) {
+        if (!std::isspace(static_cast<unsigned char>(c))) s += c;
+    }
+    if (s.empty()) return false;
+
+    // split into signed terms at the + and - outside parentheses
+    int depth = 0;
+    std::size_t start = 0;
+    Real sign = 1.;
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        const char c = s[i];
+        if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            if (--depth < 0) return false;
+        } else if (depth == 0 && (c == '+' || c == '-') && !IsExponentSign(s, i)) {
+            if (i > start) {
+                if (!AddTerm(s.substr(start, i-start), sign)) return false;
+            } else if (i != 0) {
+                return false; // two signs in a row
+            }
+            sign = (c == '-') ? -1. : 1.;
+            start = i+1;
+        }
+    }
+    if (depth != 0 || start >= s.size()) return false;
+    if (!AddTerm(s.substr(start), sign)) return false;
+
+    return !m_terms.empty();
+}
+
+bool BoxSumFunction::AddTerm (const std::string& term, Real sign)
+{
+    BoxTerm t;
+    t.value = 1.;
+    for (int d = 0; d < 3; ++d) {
+        t.lo[d] = std::numeric_limits<Real>::lowest();
+        t.hi[d] = std::numeric_limits<Real>::max();
+        t.lo_closed[d] = 1;
+        t.hi_closed[d] = 1;
+    }
+
+    // factors at the * outside parentheses
+    int depth = 0;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i <= term.size(); ++i) {
+        if (i < term.size()) {
+            if (term[i] == '(') ++depth;
+            if (term[i] == ')') --depth;
+            if (term[i] != '*' || depth != 0) continue;
+        }
+        std::string f = term.substr(start, i-start);
+        start = i+1;
+
+        if (f.size() >= 2 && f.front() == '(' && f.back() == ')') {
+            f = f.substr(1, f.size()-2);
+        }
+        Real num;
+        if (ReadNumber(f, num)) {
+            t.value *= num;
+            continue;
+        }
+
+        // comparison of one coordinate with a number: x>a, x>=a, x<a, x<=a
+        if (f.size() < 3 || (f[0] != 'x' && f[0] != 'y' && f[0] != 'z')) return false;
+        const int d = f[0] - 'x';
+        const bool greater = (f[1] == '>');
+        if (!greater && f[1] != '<') return false;
+        const bool closed = (f[2] == '=');
+        Real bound;
+        if (!ReadNumber(f.substr(closed ? 3 : 2), bound)) return false;
+
+        // keep the tighter of repeated bounds; at equal bounds the open one is tighter
+        if (greater) {
+            if (bound > t.lo[d] || (bound == t.lo[d] && !closed)) {
+                t.lo[d] = bound;
+                t.lo_closed[d] = closed;
+            }
+        } else {
+            if (bound < t.hi[d] || (bound == t.hi[d] && !closed)) {
+                t.hi[d] = bound;
+                t.hi_closed[d] = closed;
+            }
+        }
+    }
+    t.value *= sign;
+
+    m_terms.push_back(t);
+    return true;
+}
+
+Box BoxSumFunction::IndexBox (int n, const Geometry& geom, const IntVect& iv, const Box& domain) const
+{
+    const BoxTerm& t = m_terms[n];
+    const auto dx = geom.CellSizeArray();
+    const auto& real_box = geom.ProbDomain();
+
+    Box b = domain;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        // physical coordinate along index direction d; in 2D the second index is z
+        const int c = (AMREX_SPACEDIM == 3) ? d : 2*d;
+        const Real x0 = real_box.lo(d) + (1. - iv[d]) * dx[d] * 0.5;
+        if (t.lo[c] > std::numeric_limits<Real>::lowest()) {
+            const Real i_lo = std::floor((t.lo[c] - x0) / dx[d]) - 1.;
+            b.setSmall(d, static_cast<int>(amrex::Clamp(i_lo, Real(domain.smallEnd(d)), Real(domain.bigEnd(d)+1))));
+        }
+        if (t.hi[c] < std::numeric_limits<Real>::max()) {
+            const Real i_hi = std::ceil((t.hi[c] - x0) / dx[d]) + 1.;
+            b.setBig(d, static_cast<int>(amrex::Clamp(i_hi, Real(domain.smallEnd(d)-1), Real(domain.bigEnd(d)))));
+        }
+    }
+    return b;
+}
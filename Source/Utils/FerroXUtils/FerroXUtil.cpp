@@ -6,10 +6,31 @@
  */
 #include <FerroXUtil.H>
 
+#include <AMReX_OpenMP.H>
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <string>
+
+#ifdef AMREX_USE_OMP
+#include <omp.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <fstream>
+#endif
+
 using namespace amrex;
 
+namespace {
+    amrex::Vector<std::pair<std::string, amrex::Long>> memory_ledger;
+}
 
-void FerroX_Util::Contains_sc(MultiFab& MaterialMask, bool& contains_SC)
+
+void FerroX_Util::Contains_sc(MaskMultiFab& MaterialMask, bool& contains_SC)
 {
 
 	int has_SC = 0;
@@ -20,12 +41,12 @@ void FerroX_Util::Contains_sc(MultiFab& MaterialMask, bool& contains_SC)
             const auto lo = amrex::lbound(bx);
             const auto hi = amrex::ubound(bx);
 
-            const Array4<Real>& mask = MaterialMask.array(mfi);
+            const Array4<MaskType>& mask = MaterialMask.array(mfi);
 
             for (auto k = lo.z; k <= hi.z; ++k) {
             for (auto j = lo.y; j <= hi.y; ++j) {
             for (auto i = lo.x; i <= hi.x; ++i) {
-                  if (mask(i,j,k) >= 2.0) {
+                  if (mask(i,j,k) >= SC) {
                           has_SC = 1;
                   }
             }
@@ -39,3 +60,163 @@ void FerroX_Util::Contains_sc(MultiFab& MaterialMask, bool& contains_SC)
  
        if(has_SC == 1) contains_SC = true;
 }
+
+void FerroX_Util::AddToMemoryLedger(const std::string& name, amrex::Long local_bytes)
+{
+    for (auto& entry : memory_ledger) {
+        if (entry.first == name) {
+            entry.second += local_bytes;
+            return;
+        }
+    }
+    memory_ledger.emplace_back(name, local_bytes);
+}
+
+void FerroX_Util::PrintMemoryLedger(const std::string& title, amrex::Long num_cells)
+{
+    const int n = memory_ledger.size();
+    amrex::Vector<amrex::Long> sum_bytes(n+1), max_bytes(n+1);
+    amrex::Long local_total = 0;
+    for (int i = 0; i < n; ++i) {
+        sum_bytes[i] = max_bytes[i] = memory_ledger[i].second;
+        local_total += memory_ledger[i].second;
+    }
+    sum_bytes[n] = max_bytes[n] = local_total;
+
+    ParallelDescriptor::ReduceLongSum(sum_bytes.data(), n+1);
+    ParallelDescriptor::ReduceLongMax(max_bytes.data(), n+1);
+
+    // largest fields first
+    amrex::Vector<int> order(n);
+    for (int i = 0; i < n; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&] (int a, int b) { return sum_bytes[a] > sum_bytes[b]; });
+
+    const amrex::Real MB = 1048576.;
+    amrex::Print() << "\n ========= " << title << " ========== \n"
+                   << std::left << std::setw(20) << "field"
+                   << std::right << std::setw(14) << "total MB" << std::setw(14) << "max/rank MB"
+                   << std::setw(12) << "bytes/cell" << "\n";
+    for (int i : order) {
+        amrex::Print() << std::left << std::setw(20) << memory_ledger[i].first << std::right << std::fixed << std::setprecision(2)
+                       << std::setw(14) << sum_bytes[i]/MB << std::setw(14) << max_bytes[i]/MB
+                       << std::setw(12) << static_cast<amrex::Real>(sum_bytes[i])/num_cells << "\n";
+    }
+    amrex::Print() << std::left << std::setw(20) << "tracked total" << std::right
+                   << std::setw(14) << sum_bytes[n]/MB << std::setw(14) << max_bytes[n]/MB
+                   << std::setw(12) << static_cast<amrex::Real>(sum_bytes[n])/num_cells << "\n"
+                   << std::defaultfloat << std::setprecision(6);
+}
+
+void FerroX_Util::PrintFingerprint(const amrex::Array<amrex::MultiFab, 3>& P, const amrex::MultiFab& Phi)
+{
+    const char* names[4] = {"Px", "Py", "Pz", "Phi"};
+    const MultiFab* fields[4] = {&P[0], &P[1], &P[2], &Phi};
+    for (int n = 0; n < 4; ++n) {
+        const amrex::Real n0 = fields[n]->norm0();
+        const amrex::Real n1 = fields[n]->norm1();
+        const amrex::Real n2 = fields[n]->norm2();
+        amrex::Print() << std::setprecision(std::numeric_limits<amrex::Real>::max_digits10)
+                       << "Fingerprint " << names[n] << " norm0 " << n0 << " norm1 " << n1 << " norm2 " << n2 << "\n";
+    }
+}
+
+FerroX_Util::PhaseTimer::PhaseTimer ()
+    : m_last(ParallelDescriptor::second())
+{}
+
+void FerroX_Util::PhaseTimer::Mark (const std::string& phase)
+{
+    amrex::Real now = ParallelDescriptor::second();
+    amrex::Real elapsed = now - m_last;
+    ParallelDescriptor::ReduceRealMax(elapsed);
+    m_phases.emplace_back(phase, elapsed);
+    m_last = ParallelDescriptor::second();
+}
+
+void FerroX_Util::PhaseTimer::Print (const std::string& title) const
+{
+    amrex::Real total = 0.;
+    amrex::Print() << "\n ========= " << title << " ========== \n";
+    for (auto const& p : m_phases) {
+        amrex::Print() << std::left << std::setw(32) << p.first << std::right
+                       << std::setw(12) << p.second << " seconds\n";
+        total += p.second;
+    }
+    amrex::Print() << std::left << std::setw(32) << "total" << std::right
+                   << std::setw(12) << total << " seconds\n";
+}
+
+void FerroX_Util::ThreadPlacement(int& cpu, int& socket, int& numa_node)
+{
+    cpu = socket = numa_node = -1;
+#if defined(__linux__)
+    cpu = sched_getcpu();
+    if (cpu < 0) return;
+    const std::string cpu_dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    std::ifstream package(cpu_dir + "/topology/physical_package_id");
+    if (package) package >> socket;
+    // the cpu directory links the NUMA node it belongs to as nodeN
+    for (int node = 0; node < 1024; ++node) {
+        if (access((cpu_dir + "/node" + std::to_string(node)).c_str(), F_OK) == 0) {
+            numa_node = node;
+            break;
+        }
+    }
+#endif
+}
+
+void FerroX_Util::PrintThreadAffinity()
+{
+    int nthreads = OpenMP::get_max_threads();
+    ParallelDescriptor::ReduceIntMax(nthreads);
+
+    // cpu, socket, NUMA node per thread; -1 for threads a rank does not have
+    Vector<int> local(3*nthreads, -1);
+#ifdef AMREX_USE_OMP
+#pragma omp parallel
+#endif
+    {
+        const int t = OpenMP::get_thread_num();
+        ThreadPlacement(local[3*t], local[3*t+1], local[3*t+2]);
+    }
+
+    const int nprocs = ParallelDescriptor::NProcs();
+    const int IOProc = ParallelDescriptor::IOProcessorNumber();
+    Vector<int> all(ParallelDescriptor::IOProcessor() ? 3*nthreads*nprocs : 1);
+    ParallelDescriptor::Gather(local.data(), 3*nthreads, all.data(), IOProc);
+
+    if (!ParallelDescriptor::IOProcessor()) return;
+
+    amrex::Print() << "\n ========= Thread affinity ========== \n";
+#ifdef AMREX_USE_OMP
+    const char* bind_names[] = {"false", "true", "master", "close", "spread"};
+    const int bind = static_cast<int>(omp_get_proc_bind());
+    amrex::Print() << "OMP_PROC_BIND: " << ((bind >= 0 && bind <= 4) ? bind_names[bind] : "unknown") << "\n";
+    if (bind == 0) {
+        amrex::Print() << "Warning: OpenMP threads are not pinned (set OMP_PROC_BIND and OMP_PLACES);"
+                       << " the placement below may change during the run\n";
+    }
+#endif
+    amrex::Print() << std::setw(6) << "rank" << std::setw(8) << "thread" << std::setw(6) << "cpu"
+                   << std::setw(8) << "socket" << std::setw(6) << "numa" << "\n";
+    for (int r = 0; r < nprocs; ++r) {
+        Vector<int> sockets;
+        for (int t = 0; t < nthreads; ++t) {
+            const int* p = &all[3*(r*nthreads + t)];
+            if (p[0] < 0 && p[1] < 0) continue;
+            amrex::Print() << std::setw(6) << r << std::setw(8) << t << std::setw(6) << p[0]
+                           << std::setw(8) << p[1] << std::setw(6) << p[2] << "\n";
+            if (std::find(sockets.begin(), sockets.end(), p[1]) == sockets.end()) sockets.push_back(p[1]);
+            for (int t2 = 0; t2 < t; ++t2) {
+                if (p[0] >= 0 && all[3*(r*nthreads + t2)] == p[0]) {
+                    amrex::Print() << "Warning: rank " << r << " threads " << t2 << " and " << t
+                                   << " share cpu " << p[0] << "\n";
+                }
+            }
+        }
+        if (sockets.size() > 1) {
+            amrex::Print() << "Note: the threads of rank " << r << " span " << sockets.size()
+                           << " sockets; pages follow the tile schedule (first touch)\n";
+        }
+    }
+}
@@ -0,0 +1,258 @@
+/*
+ * This file is part of FerroX.
+ *
+ * Contributor: Prabhat Kumar
+ *
+ */
+#include "PerfCounters.H"
+
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_OpenMP.H>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <unordered_map>
+
+using namespace amrex;
+using namespace FerroX;
+
+namespace {
+
+const char* counter_names[FerroX_Perf::NumCounters] = {
+    "newton_iterations", "mlmg_solves", "mlmg_vcycles", "cells_updated", "bytes_exchanged", "messages_sent"
+};
+
+// counters that are identical on all ranks are reduced with max, the others are summed
+const bool counter_is_global[FerroX_Perf::NumCounters] = {true, true, true, false, false, false};
+
+Long counters[FerroX_Perf::NumCounters] = {0, 0, 0, 0, 0, 0};
+
+struct RegionStats
+{
+    std::string name;
+    Long calls = 0;
+    double time = 0.;
+};
+
+Vector<RegionStats> regions;
+std::unordered_map<std::string, int> region_ids;
+
+// local send traffic of one FillBoundary with nghost ghost cells; the pattern is cached by AMReX
+void LocalHaloTraffic (const MultiFab& mf, const IntVect& nghost, const Periodicity& period,
+                       Long& messages, Long& bytes)
+{
+    messages = 0;
+    bytes = 0;
+    const auto& fb = mf.getFB(nghost, period);
+    if (fb.m_SndTags) {
+        Long npts = 0;
+        for (const auto& kv : *fb.m_SndTags) {
+            ++messages; // one message per destination rank
+            for (const auto& tag : kv.second) npts += tag.sbox.numPts();
+        }
+        bytes = npts * mf.nComp() * static_cast<Long>(sizeof(Real));
+    }
+}
+
+// counters since the previous step record
+struct StepRecord
+{
+    int step;
+    Real time;
+    Real step_time;
+    Long counters[FerroX_Perf::NumCounters];
+};
+
+Vector<StepRecord> step_records;
+Long counters_at_last_record[FerroX_Perf::NumCounters] = {0, 0, 0, 0, 0, 0};
+
+} // namespace
+
+bool FerroX_Perf::Enabled ()
+{
+    return !FerroX::perf_report_file.empty();
+}
+
+void FerroX_Perf::Add (Counter c, Long n)
+{
+    counters[c] += n;
+}
+
+void FerroX_Perf::FillBoundary (MultiFab& mf, const Periodicity& period)
+{
+    FERROX_PROFILE("FillBoundary");
+
+    if (Enabled() && ParallelDescriptor::NProcs() > 1) {
+        Long messages, bytes;
+        LocalHaloTraffic(mf, mf.nGrowVect(), period, messages, bytes);
+        counters[BytesExchanged] += bytes;
+        counters[MessagesSent] += messages;
+    }
+
+    mf.FillBoundary(period);
+}
+
+void FerroX_Perf::HaloTraffic (const MultiFab& mf, int nghost, const Periodicity& period,
+                               Long& messages, Long& bytes)
+{
+    Long traffic[2] = {0, 0};
+    if (ParallelDescriptor::NProcs() > 1) {
+        LocalHaloTraffic(mf, IntVect(nghost), period, traffic[0], traffic[1]);
+    }
+    ParallelDescriptor::ReduceLongSum(traffic, 2);
+    messages = traffic[0];
+    bytes = traffic[1];
+}
+
+void FerroX_Perf::EndStep (int step, Real time, Real step_time)
+{
+    if (!Enabled() || perf_report_int <= 0 || step % perf_report_int != 0) return;
+
+    StepRecord rec;
+    rec.step = step;
+    rec.time = time;
+    rec.step_time = step_time;
+    for (int c = 0; c < NumCounters; ++c) {
+        rec.counters[c] = counters[c] - counters_at_last_record[c];
+        counters_at_last_record[c] = counters[c];
+    }
+    step_records.push_back(rec);
+}
+
+void FerroX_Perf::WriteReport (const BoxArray& ba, int nsteps, Real total_time)
+{
+    if (!Enabled()) return;
+
+    const int IOProc = ParallelDescriptor::IOProcessorNumber();
+
+    // region names are sorted so that all ranks reduce the same entries
+    Vector<RegionStats> sorted = regions;
+    std::sort(sorted.begin(), sorted.end(),
+              [] (const RegionStats& a, const RegionStats& b) { return a.name < b.name; });
+    // same count and same names on every rank: FNV-1a hash of the sorted names, NUL-separated
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (const auto& reg : sorted) {
+        for (char c : reg.name + '\0') {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+        }
+    }
+    Long check_min[2] = {static_cast<Long>(sorted.size()), static_cast<Long>(hash)};
+    Long check_max[2] = {check_min[0], check_min[1]};
+    ParallelDescriptor::ReduceLongMin(check_min, 2);
+    ParallelDescriptor::ReduceLongMax(check_max, 2);
+    if (check_min[0] != check_max[0] || check_min[1] != check_max[1]) {
+        amrex::Abort("FerroX_Perf::WriteReport: FERROX_PROFILE regions differ between ranks");
+    }
+    const int nreg = sorted.size();
+
+    Vector<Real> t_max(nreg), t_sum(nreg);
+    Vector<Long> calls(nreg);
+    for (int r = 0; r < nreg; ++r) {
+        t_max[r] = t_sum[r] = sorted[r].time;
+        calls[r] = sorted[r].calls;
+    }
+    ParallelDescriptor::ReduceRealMax(t_max.data(), nreg, IOProc);
+    ParallelDescriptor::ReduceRealSum(t_sum.data(), nreg, IOProc);
+    ParallelDescriptor::ReduceLongMax(calls.data(), nreg, IOProc);
+
+    // totals and step records in one flattened array per reduction type
+    const int nrec = step_records.size();
+    Vector<Long> c_sum((nrec+1)*NumCounters), c_max((nrec+1)*NumCounters);
+    for (int c = 0; c < NumCounters; ++c) c_sum[c] = c_max[c] = counters[c];
+    for (int n = 0; n < nrec; ++n) {
+        for (int c = 0; c < NumCounters; ++c) {
+            c_sum[(n+1)*NumCounters+c] = c_max[(n+1)*NumCounters+c] = step_records[n].counters[c];
+        }
+    }
+    ParallelDescriptor::ReduceLongSum(c_sum.data(), c_sum.size(), IOProc);
+    ParallelDescriptor::ReduceLongMax(c_max.data(), c_max.size(), IOProc);
+
+    // step times are local, the record holds the slowest rank
+    Vector<Real> step_time(nrec);
+    for (int n = 0; n < nrec; ++n) step_time[n] = step_records[n].step_time;
+    ParallelDescriptor::ReduceRealMax(step_time.data(), nrec, IOProc);
+
+    if (!ParallelDescriptor::IOProcessor()) return;
+
+    auto counter_value = [&] (int n, int c) {
+        return counter_is_global[c] ? c_max[n*NumCounters+c] : c_sum[n*NumCounters+c];
+    };
+
+    std::ofstream ofs(perf_report_file);
+    if (!ofs.good()) amrex::FileOpenFailed(perf_report_file);
+    ofs << std::setprecision(std::numeric_limits<Real>::max_digits10);
+
+    const int nprocs = ParallelDescriptor::NProcs();
+    ofs << "{\n"
+        << "  \"code\": \"FerroX\",\n"
+        << "  \"dim\": " << AMREX_SPACEDIM << ",\n"
+#ifdef AMREX_USE_GPU
+        << "  \"gpu\": true,\n"
+#else
+        << "  \"gpu\": false,\n"
+#endif
+#ifdef FERROX_MIXED_PRECISION
+        << "  \"mixed_precision\": true,\n"
+#else
+        << "  \"mixed_precision\": false,\n"
+#endif
+        << "  \"ranks\": " << nprocs << ",\n"
+        << "  \"threads\": " << OpenMP::get_max_threads() << ",\n"
+        << "  \"cells\": " << ba.numPts() << ",\n"
+        << "  \"boxes\": " << ba.size() << ",\n"
+        << "  \"time_integrator_order\": " << TimeIntegratorOrder << ",\n"
+        << "  \"steps\": " << nsteps << ",\n"
+        << "  \"wall_time\": " << total_time << ",\n";
+
+    ofs << "  \"counters\": {";
+    for (int c = 0; c < NumCounters; ++c) {
+        ofs << (c ? ", " : "") << "\"" << counter_names[c] << "\": " << counter_value(0, c);
+    }
+    ofs << "},\n";
+
+    ofs << "  \"regions\": {\n";
+    for (int r = 0; r < nreg; ++r) {
+        ofs << "    \"" << sorted[r].name << "\": {\"calls\": " << calls[r]
+            << ", \"time_max\": " << t_max[r] << ", \"time_avg\": " << t_sum[r]/nprocs << "}"
+            << (r+1 < nreg ? ",\n" : "\n");
+    }
+    ofs << "  },\n";
+
+    ofs << "  \"step_records\": [";
+    for (int n = 0; n < nrec; ++n) {
+        const auto& rec = step_records[n];
+        ofs << (n ? ",\n" : "\n") << "    {\"step\": " << rec.step << ", \"time\": " << rec.time
+            << ", \"step_time\": " << step_time[n];
+        for (int c = 0; c < NumCounters; ++c) {
+            ofs << ", \"" << counter_names[c] << "\": " << counter_value(n+1, c);
+        }
+        ofs << "}";
+    }
+    ofs << (nrec ? "\n  ]\n" : "]\n") << "}\n";
+
+    amrex::Print() << "Performance report written to " << perf_report_file << "\n";
+}
+
+FerroX_Perf::Region::Region (const char* name)
+{
+    if (!Enabled()) return;
+
+    auto it = region_ids.find(name);
+    if (it == region_ids.end()) {
+        it = region_ids.emplace(name, static_cast<int>(regions.size())).first;
+        regions.push_back(RegionStats{name});
+    }
+    m_id = it->second;
+    ablastr::profiler::device_synchronize(c_FerroX::do_device_synchronize);
+    m_start = ParallelDescriptor::second();
+}
+
+FerroX_Perf::Region::~Region ()
+{
+    if (m_id < 0) return;
+    regions[m_id].time += ParallelDescriptor::second() - m_start;
+    ++regions[m_id].calls;
+}
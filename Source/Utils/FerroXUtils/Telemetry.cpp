@@ -0,0 +1,112 @@
+/*
+ * This file is part of FerroX.
+ *
+ * Contributor: Prabhat Kumar
+ *
+ */
+#include "Telemetry.H"
+
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_Print.H>
+
+#include <algorithm>
+
+using namespace amrex;
+using namespace FerroX;
+
+namespace {
+
+struct StepEntry
+{
+    int step;
+    Real step_time;
+    int newton_iters;
+};
+
+Vector<StepEntry> ring;
+int current_newton_iters = 0;
+bool in_step = false;
+bool detail_step = true;
+bool carried = false;  // current_newton_iters holds work carried into the next step
+
+} // namespace
+
+void FerroX_Telemetry::BeginStep (int step)
+{
+    in_step = true;
+    detail_step = (step % amrex::max(step_log_int, 1) == 0);
+    if (!carried) current_newton_iters = 0;
+    carried = false;
+}
+
+void FerroX_Telemetry::BeginCarry (int next_step)
+{
+    in_step = true;
+    detail_step = (next_step % amrex::max(step_log_int, 1) == 0);
+    current_newton_iters = 0;
+    carried = true;
+}
+
+void FerroX_Telemetry::EndCarry ()
+{
+    in_step = false;
+}
+
+void FerroX_Telemetry::AddNewtonIterations (int iters)
+{
+    current_newton_iters += iters;
+}
+
+void FerroX_Telemetry::EndStep (int step, Real step_time)
+{
+    ring.push_back({step, step_time, current_newton_iters});
+    in_step = false;
+    if (static_cast<int>(ring.size()) >= amrex::max(step_log_int, 1)) Flush();
+}
+
+void FerroX_Telemetry::Flush ()
+{
+    const int n = ring.size();
+    if (n == 0) return;
+
+    // max over ranks of every step time, one collective for the whole ring
+    Vector<Real> times(n);
+    for (int s = 0; s < n; ++s) times[s] = ring[s].step_time;
+    ParallelDescriptor::ReduceRealMax(times.data(), n, ParallelDescriptor::IOProcessorNumber());
+
+    if (n == 1) {
+        amrex::Print() << "Advanced step " << ring[0].step << " in " << times[0] << " seconds\n";
+        amrex::Print() << " \n";
+    } else {
+        if (log_verbosity >= 2) {
+            for (int s = 0; s < n; ++s) {
+                amrex::Print() << "Advanced step " << ring[s].step << " in " << times[s] << " seconds, "
+                               << ring[s].newton_iters << " Newton iterations\n";
+            }
+        }
+        Real t_sum = 0., t_min = times[0], t_max = times[0];
+        long newton_sum = 0;
+        for (int s = 0; s < n; ++s) {
+            t_sum += times[s];
+            t_min = std::min(t_min, times[s]);
+            t_max = std::max(t_max, times[s]);
+            newton_sum += ring[s].newton_iters;
+        }
+        amrex::Print() << "Advanced steps " << ring[0].step << "-" << ring[n-1].step << " in " << t_sum
+                       << " seconds (per step avg " << t_sum/n << ", min " << t_min << ", max " << t_max
+                       << "), " << static_cast<Real>(newton_sum)/n << " Newton iterations per step\n";
+        amrex::Print() << " \n";
+    }
+
+    ring.clear();
+}
+
+bool FerroX_Telemetry::Verbose ()
+{
+    return log_verbosity >= 1 && (!in_step || detail_step);
+}
+
+bool FerroX_Telemetry::VerboseNewton ()
+{
+    return newton_verbosity >= 1 && Verbose();
+}
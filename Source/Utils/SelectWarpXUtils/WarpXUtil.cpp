@@ -91,6 +91,9 @@ void Store_parserString(const amrex::ParmParse& pp, std::string query_string,
     std::vector<std::string> f;
     pp.getarr(query_string.c_str(), f);
     stored_string.clear();
+    std::size_t total_length = 0;
+    for (auto const& s : f) total_length += s.size();
+    stored_string.reserve(total_length);
     for (auto const& s : f) {
         stored_string += s;
     }
@@ -42,11 +42,20 @@ eXstatic_MFab_Util::InitializeMacroMultiFabUsingParser_3vars (amrex::MultiFab *m
                 amrex::Real fac_x = (1._rt - iv[0]) * dx[0] * 0.5_rt;
                 amrex::Real x = i * dx[0] + real_box.lo(0) + fac_x;
 
+#if (AMREX_SPACEDIM == 3)
                 amrex::Real fac_y = (1._rt - iv[1]) * dx[1] * 0.5_rt;
                 amrex::Real y = j * dx[1] + real_box.lo(1) + fac_y;
 
                 amrex::Real fac_z = (1._rt - iv[2]) * dx[2] * 0.5_rt;
                 amrex::Real z = k * dx[2] + real_box.lo(2) + fac_z;
+#else
+                // x-z plane: the second index direction is z, y is held at zero
+                amrex::ignore_unused(k);
+                amrex::Real y = 0._rt;
+
+                amrex::Real fac_z = (1._rt - iv[1]) * dx[1] * 0.5_rt;
+                amrex::Real z = j * dx[1] + real_box.lo(1) + fac_z;
+#endif
 
                 mf_array(i,j,k) = macro_parser(x,y,z);
         });
@@ -87,11 +96,20 @@ eXstatic_MFab_Util::InitializeMacroMultiFabUsingParser_4vars (amrex::MultiFab *m
                 amrex::Real fac_x = (1._rt - iv[0]) * dx[0] * 0.5_rt;
                 amrex::Real x = i * dx[0] + real_box.lo(0) + fac_x;
 
+#if (AMREX_SPACEDIM == 3)
                 amrex::Real fac_y = (1._rt - iv[1]) * dx[1] * 0.5_rt;
                 amrex::Real y = j * dx[1] + real_box.lo(1) + fac_y;
 
                 amrex::Real fac_z = (1._rt - iv[2]) * dx[2] * 0.5_rt;
                 amrex::Real z = k * dx[2] + real_box.lo(2) + fac_z;
+#else
+                // x-z plane: the second index direction is z, y is held at zero
+                amrex::ignore_unused(k);
+                amrex::Real y = 0._rt;
+
+                amrex::Real fac_z = (1._rt - iv[1]) * dx[1] * 0.5_rt;
+                amrex::Real z = j * dx[1] + real_box.lo(1) + fac_z;
+#endif
 
                 mf_array(i,j,k) = macro_parser(x,y,z,t);
         });
@@ -122,7 +140,8 @@ eXstatic_MFab_Util::AverageCellCenteredMultiFabToCellFaces(const amrex::MultiFab
                      const Box & nodal_y = mfi.nodaltilebox(1);,
                      const Box & nodal_z = mfi.nodaltilebox(2););
 
-        amrex::ParallelFor(nodal_x, nodal_y, nodal_z,
+        amrex::ParallelFor(AMREX_D_DECL(nodal_x, nodal_y, nodal_z),
+        AMREX_D_DECL(
         [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
         {
             facex(i,j,k) = 0.5*(cc(i,j,k)+cc(i-1,j,k));
@@ -134,7 +153,7 @@ eXstatic_MFab_Util::AverageCellCenteredMultiFabToCellFaces(const amrex::MultiFab
         [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
         {
             facez(i,j,k) = 0.5*(cc(i,j,k)+cc(i,j,k-1));
-        });
+        }));
     }
 #ifdef PRINT_NAME
     amrex::Print() << "\t\t\t\t\t}************************eXstatic_MFab_Util::AverageCellCenteredMultiFabToCellFaces()************************\n";
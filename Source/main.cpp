@@ -14,12 +14,20 @@
 #include "Solver/Initialization.H"
 #include "Solver/ChargeDensity.H"
 #include "Solver/TotalEnergyDensity.H"
+#include "Solver/ColumnSolver.H"
+#include "Solver/GrainGenerator.H"
+#include "Solver/FieldImport.H"
+#include "Diagnostics/ReducedDiagnostics.H"
+#include "Diagnostics/Probes.H"
+#include "Diagnostics/FreeEnergy.H"
 #include "Input/BoundaryConditions/BoundaryConditions.H"
 #include "Input/GeometryProperties/GeometryProperties.H"
 #include "Utils/SelectWarpXUtils/WarpXUtil.H"
 #include "Utils/SelectWarpXUtils/WarpXProfilerWrapper.H"
 #include "Utils/eXstaticUtils/eXstaticUtil.H"
 #include "Utils/FerroXUtils/FerroXUtil.H"
+#include "Utils/FerroXUtils/PerfCounters.H"
+#include "Utils/FerroXUtils/Telemetry.H"
 
 
 
@@ -34,8 +42,18 @@ int main (int argc, char* argv[])
     
     {
 	    c_FerroX pFerroX;
-            pFerroX.InitData();
-            main_main(pFerroX);
+
+            // column_mode = 1 : quasi-1D solve along the stack for laterally homogeneous devices
+            int column_mode = 0;
+            ParmParse pp;
+            pp.query("column_mode", column_mode);
+
+            if (column_mode == 1) {
+                RunColumnSolver(pFerroX);
+            } else {
+                pFerroX.InitData();
+                main_main(pFerroX);
+            }
     }
     amrex::Finalize();
     return 0;
@@ -57,104 +75,160 @@ void main_main (c_FerroX& rFerroX)
     auto& prob_hi = rGprop.prob_hi;
     auto& n_cell = rGprop.n_cell;
 
+    // wall time of each initialization phase, printed before time stepping
+    FerroX_Util::PhaseTimer init_timer;
+
     // read in inputs file
     InitializeFerroXNamespace(prob_lo, prob_hi);
+    init_timer.Mark("read inputs");
+
+    if (print_thread_affinity == 1) FerroX_Util::PrintThreadAffinity();
+
+    // With wide_halo the predictor is also computed on the first halo_ngrow ghost layers, as far
+    // as the polarization stencils reach (two cells for the one-sided P_BC_flag 4), so P_old
+    // carries twice that and P_new_pre is correct in its halo without a FillBoundary
+    int P_reach = 1;
+    for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+        if (P_BC_flag_lo[d] == 4 || P_BC_flag_hi[d] == 4) P_reach = 2;
+    }
+    const int halo_ngrow = (wide_halo == 1) ? P_reach : 0;
 
     // Nghost = number of ghost cells for each array
-    int Nghost = 1;
+    int Nghost = (wide_halo == 1) ? 2*P_reach : 1;
+
+    // ghost layers the time integrator updates: with wide_halo those on which GL_rhs is computed
+    const int Nghost_update = (wide_halo == 1) ? halo_ngrow : Nghost;
 
     // Ncomp = number of components for each array
     int Ncomp = 1;
 
-    MultiFab Gamma(ba, dm, Ncomp, Nghost);
+    StaticMultiFab Gamma(ba, dm, Ncomp, Nghost);
 
-    Array<MultiFab, AMREX_SPACEDIM> P_old;
-    for (int dir = 0; dir < AMREX_SPACEDIM; dir++)
+    Array<MultiFab, 3> P_old;
+    for (int dir = 0; dir < 3; dir++)
     {
         P_old[dir].define(ba, dm, Ncomp, Nghost);
     }
 
-    Array<MultiFab, AMREX_SPACEDIM> P_new;
-    for (int dir = 0; dir < AMREX_SPACEDIM; dir++)
-    {
-        P_new[dir].define(ba, dm, Ncomp, Nghost);
+    // The corrector arrays are only needed by the second-order integrator
+    const bool need_corrector = (TimeIntegratorOrder != 1);
+
+    Array<MultiFab, 3> P_new;
+    if (need_corrector) {
+        for (int dir = 0; dir < 3; dir++)
+        {
+            P_new[dir].define(ba, dm, Ncomp, Nghost);
+        }
     }
 
-    Array<MultiFab, AMREX_SPACEDIM> P_new_pre;
-    for (int dir = 0; dir < AMREX_SPACEDIM; dir++)
+    Array<MultiFab, 3> P_new_pre;
+    for (int dir = 0; dir < 3; dir++)
     {
         P_new_pre[dir].define(ba, dm, Ncomp, Nghost);
     }
 
-    Array<MultiFab, AMREX_SPACEDIM> GL_rhs;
-    for (int dir = 0; dir < AMREX_SPACEDIM; dir++)
+    Array<MultiFab, 3> GL_rhs;
+    for (int dir = 0; dir < 3; dir++)
     {
         GL_rhs[dir].define(ba, dm, Ncomp, Nghost);
     }
 
-    Array<MultiFab, AMREX_SPACEDIM> GL_rhs_pre;
-    for (int dir = 0; dir < AMREX_SPACEDIM; dir++)
-    {
-        GL_rhs_pre[dir].define(ba, dm, Ncomp, Nghost);
-    }
-
-    Array<MultiFab, AMREX_SPACEDIM> GL_rhs_avg;
-    for (int dir = 0; dir < AMREX_SPACEDIM; dir++)
-    {
-        GL_rhs_avg[dir].define(ba, dm, Ncomp, Nghost);
+    // GL_rhs_pre is only written in valid cells and only read by a valid-region Saxpy
+    Array<MultiFab, 3> GL_rhs_pre;
+    if (need_corrector) {
+        for (int dir = 0; dir < 3; dir++)
+        {
+            GL_rhs_pre[dir].define(ba, dm, Ncomp, 0);
+        }
     }
 
-    Array<MultiFab, AMREX_SPACEDIM> E;
-    for (int dir = 0; dir < AMREX_SPACEDIM; dir++)
-    {
-        E[dir].define(ba, dm, Ncomp, 0);
+    // With compute_E_on_the_fly the TDGL kernel differentiates PoissonPhi_E, a copy of the potential
+    // taken where E would be stored, so the corrector and the step after a voltage increment see the
+    // same field in both modes; E is only allocated while a plotfile is written
+    Array<MultiFab, 3> E;
+    MultiFab PoissonPhi_E;
+    if (compute_E_on_the_fly == 0) {
+        for (int dir = 0; dir < 3; dir++)
+        {
+            E[dir].define(ba, dm, Ncomp, halo_ngrow);
+        }
+    } else {
+        PoissonPhi_E.define(ba, dm, 1, 1 + halo_ngrow);
     }
 
     MultiFab PoissonRHS(ba, dm, 1, 0);
-    MultiFab PoissonPhi(ba, dm, 1, 1);
-    MultiFab PoissonPhi_Old(ba, dm, 1, 1);
-    MultiFab PoissonPhi_Prev(ba, dm, 1, 1);
-    MultiFab PhiErr(ba, dm, 1, 1);
-    MultiFab Phidiff(ba, dm, 1, 1);
-    MultiFab Ex(ba, dm, 1, 0);
-    MultiFab Ey(ba, dm, 1, 0);
-    MultiFab Ez(ba, dm, 1, 0);
+    MultiFab PoissonPhi(ba, dm, 1, 1 + halo_ngrow);
+    // potential the TDGL kernel takes E from; only read with compute_E_on_the_fly
+    MultiFab& PoissonPhi_TDGL = (compute_E_on_the_fly == 1) ? PoissonPhi_E : PoissonPhi;
+    MultiFab PoissonPhi_Old;  // potential of the previous step, only for the phi steady-state criterion
+    if (steady_state_criterion == "phi") PoissonPhi_Old.define(ba, dm, 1, 0);
+    MultiFab PoissonPhi_Prev; // Newton history, only needed with a semiconductor region
+    MultiFab Phidiff;         // only materialized for plotting
+    if (plot_PhiDiff) Phidiff.define(ba, dm, 1, 0);
 
     MultiFab hole_den(ba, dm, 1, 0);
     MultiFab e_den(ba, dm, 1, 0);
     MultiFab charge_den(ba, dm, 1, 0);
-    MultiFab MaterialMask(ba, dm, 1, 1);
-    MultiFab tphaseMask(ba, dm, 1, 1);
-    MultiFab angle_alpha(ba, dm, 1, 0);
-    MultiFab angle_beta(ba, dm, 1, 0);
-    MultiFab angle_theta(ba, dm, 1, 0);
-
-    for (int dir = 0; dir < AMREX_SPACEDIM; dir++)
+    MaskMultiFab MaterialMask(ba, dm, 1, 1 + halo_ngrow);
+    MaskMultiFab tphaseMask(ba, dm, 1, amrex::max(1, halo_ngrow));
+    StaticMultiFab angle_alpha(ba, dm, 1, halo_ngrow);
+    StaticMultiFab angle_beta(ba, dm, 1, halo_ngrow);
+    StaticMultiFab angle_theta(ba, dm, 1, halo_ngrow);
+    iMultiFab GrainID;        // only materialized for plotting generated grains
+    if (use_grain_generator && plot_grain_id) GrainID.define(ba, dm, 1, 0);
+
+    // zero every field with the kernels' tiling and thread schedule before anything else writes
+    // to it, so on CPU nodes the pages are placed on the NUMA node of the thread using them
     {
-        P_old[dir].setVal(0.);
-        P_new[dir].setVal(0.);
-        P_new_pre[dir].setVal(0.);
-        GL_rhs[dir].setVal(0.);
-        GL_rhs_pre[dir].setVal(0.);
-        GL_rhs_avg[dir].setVal(0.);
-        E[dir].setVal(0.);
+        using FerroX_Util::FirstTouch;
+        for (int dir = 0; dir < 3; dir++)
+        {
+            FirstTouch(P_old[dir]);
+            FirstTouch(P_new_pre[dir]);
+            FirstTouch(GL_rhs[dir]);
+            FirstTouch(P_new[dir]);
+            FirstTouch(GL_rhs_pre[dir]);
+            FirstTouch(E[dir]);
+        }
+        FirstTouch(Gamma);
+        FirstTouch(PoissonRHS);
+        FirstTouch(PoissonPhi);
+        FirstTouch(PoissonPhi_Old);
+        FirstTouch(PoissonPhi_E);
+        FirstTouch(Phidiff);
+        FirstTouch(e_den);
+        FirstTouch(hole_den);
+        FirstTouch(charge_den);
+        FirstTouch(MaterialMask);
+        FirstTouch(tphaseMask);
+        FirstTouch(angle_alpha);
+        FirstTouch(angle_beta);
+        FirstTouch(angle_theta);
+        FirstTouch(GrainID);
     }
 
-    e_den.setVal(0.);
-    hole_den.setVal(0.);
-    PoissonPhi.setVal(0.);
-    PoissonRHS.setVal(0.);
-    tphaseMask.setVal(0.);
-    angle_alpha.setVal(0.);
-    angle_beta.setVal(0.);
-    angle_theta.setVal(0.);
+    init_timer.Mark("allocate fields");
 
     //Initialize material mask
     InitializeMaterialMask(MaterialMask, geom, prob_lo, prob_hi);
     //InitializeMaterialMask(rFerroX, geom, MaterialMask);
+    init_timer.Mark("material mask");
     if(Coordinate_Transformation == 1){
-       Initialize_tphase_Mask(rFerroX, geom, tphaseMask);
-       Initialize_Euler_angles(rFerroX, geom, angle_alpha, angle_beta, angle_theta);
+       if (use_grain_generator == 1) {
+          InitializeGrains(rFerroX, geom, tphaseMask, angle_alpha, angle_beta, angle_theta,
+                           GrainID.ok() ? &GrainID : nullptr);
+          init_timer.Mark("grain generator");
+       } else {
+          Initialize_tphase_Mask(rFerroX, geom, tphaseMask);
+          init_timer.Mark("t-phase mask");
+          Initialize_Euler_angles(rFerroX, geom, angle_alpha, angle_beta, angle_theta);
+          init_timer.Mark("Euler angles");
+       }
+    }
+
+    //Overwrite with precomputed microstructure fields (import.*), if any are given
+    if (ImportMicrostructure(geom, MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta)) {
+       init_timer.Mark("microstructure import");
     }
 
     bool contains_SC = false;
@@ -162,6 +236,32 @@ void main_main (c_FerroX& rFerroX)
     FerroX_Util::Contains_sc(MaterialMask, contains_SC);
     amrex::Print() << "contains_SC = " << contains_SC << "\n";
 
+    if (contains_SC) {
+        PoissonPhi_Prev.define(ba, dm, 1, 0);
+        FerroX_Util::FirstTouch(PoissonPhi_Prev);
+    }
+    amrex::Print() << "Static field storage (Gamma, Euler angles): "
+                   << 8*sizeof(StaticReal) << "-bit, "
+                   << (Ncomp + 3)*sizeof(StaticReal) << " bytes/cell; masks: "
+                   << 2*sizeof(MaskType) << " bytes/cell\n";
+
+    // memory traffic of the field kernels of one step, every field read or written once per cell;
+    // MLMG V-cycles are not included (see the Poisson solve statistics)
+    {
+        const Real R = sizeof(Real), S = sizeof(StaticReal), M = sizeof(MaskType);
+        const Real E_bytes = (compute_E_on_the_fly == 1) ? R : 3*R;
+        const Real tdgl = 3*R + E_bytes + S + 2*M + 3*S + 3*R;  // P, E or phi, Gamma, masks, angles -> GL_rhs
+        const Real poisson_rhs = 3*R + R + M + 3*S + R;         // P, rho, mask, angles -> RHS
+        const Real rho = contains_SC ? R + M + 3*R : 0.;        // phi, mask -> rho, e, h (per Phi-rho iteration)
+        const Real e_from_phi = (compute_E_on_the_fly == 1) ? 2*R : R + 3*S + 3*R;
+        const Real lincomb = 9*R, copy = 6*R;
+        const Real bytes_per_step = (TimeIntegratorOrder == 1)
+            ? tdgl + lincomb + poisson_rhs + rho + copy + e_from_phi
+            : 2*tdgl + 3*lincomb + 2*(poisson_rhs + rho) + copy + e_from_phi;
+        amrex::Print() << "Field kernel memory traffic: " << bytes_per_step
+                       << " bytes/cell/step (P, E, phi, rho and static fields; MLMG not included)\n";
+    }
+
     std::array<std::array<amrex::LinOpBCType,AMREX_SPACEDIM>,2> LinOpBCType_2d;
     bool all_homogeneous_boundaries = true;
     bool some_functionbased_inhomogeneous_boundaries = false;
@@ -176,14 +276,65 @@ void main_main (c_FerroX& rFerroX)
     AMREX_D_TERM(beta_face[0].define(convert(ba,IntVect(AMREX_D_DECL(1,0,0))), dm, 1, 0);,
                  beta_face[1].define(convert(ba,IntVect(AMREX_D_DECL(0,1,0))), dm, 1, 0);,
                  beta_face[2].define(convert(ba,IntVect(AMREX_D_DECL(0,0,1))), dm, 1, 0););
+    FerroX_Util::FirstTouch(alpha_cc);
+    FerroX_Util::FirstTouch(beta_cc);
+    for (int dir = 0; dir < AMREX_SPACEDIM; ++dir) FerroX_Util::FirstTouch(beta_face[dir]);
 
     // set cell-centered beta coefficient to permittivity based on mask
     InitializePermittivity(LinOpBCType_2d, beta_cc, MaterialMask, tphaseMask, n_cell, geom, prob_lo, prob_hi);
     eXstatic_MFab_Util::AverageCellCenteredMultiFabToCellFaces(beta_cc, beta_face);
+    init_timer.Mark("permittivity");
+
+    // memory ledger of the persistent fields
+    {
+        using FerroX_Util::AddToMemoryLedger;
+        const char* xyz[3] = {"x", "y", "z"};
+        for (int dir = 0; dir < 3; dir++) {
+            const std::string c = xyz[dir];
+            AddToMemoryLedger("P_old_"+c, P_old[dir]);
+            AddToMemoryLedger("P_new_pre_"+c, P_new_pre[dir]);
+            AddToMemoryLedger("P_new_"+c, P_new[dir]);
+            AddToMemoryLedger("GL_rhs_"+c, GL_rhs[dir]);
+            AddToMemoryLedger("GL_rhs_pre_"+c, GL_rhs_pre[dir]);
+            AddToMemoryLedger("E_"+c, E[dir]);
+        }
+        AddToMemoryLedger("PoissonPhi", PoissonPhi);
+        AddToMemoryLedger("PoissonPhi_Old", PoissonPhi_Old);
+        AddToMemoryLedger("PoissonPhi_E", PoissonPhi_E);
+        AddToMemoryLedger("PoissonPhi_Prev", PoissonPhi_Prev);
+        AddToMemoryLedger("PoissonRHS", PoissonRHS);
+        AddToMemoryLedger("Phidiff", Phidiff);
+        AddToMemoryLedger("hole_den", hole_den);
+        AddToMemoryLedger("e_den", e_den);
+        AddToMemoryLedger("charge_den", charge_den);
+        AddToMemoryLedger("Gamma", Gamma);
+        AddToMemoryLedger("MaterialMask", MaterialMask);
+        AddToMemoryLedger("tphaseMask", tphaseMask);
+        AddToMemoryLedger("angle_alpha", angle_alpha);
+        AddToMemoryLedger("angle_beta", angle_beta);
+        AddToMemoryLedger("angle_theta", angle_theta);
+        AddToMemoryLedger("GrainID", GrainID);
+        AddToMemoryLedger("alpha_cc", alpha_cc);
+        AddToMemoryLedger("beta_cc", beta_cc);
+        for (int dir = 0; dir < AMREX_SPACEDIM; dir++) {
+            AddToMemoryLedger("beta_face", beta_face[dir]);
+        }
+    }
+    FerroX_Util::PrintMemoryLedger("Field memory ledger", ba.numPts());
+    init_timer.Mark("memory ledger");
     
     // time = starting time in the simulation
     Real time = 0.0;
 
+    int steady_state_step = 1000000; //Initialize to a large number. It will be overwritten by the time step at which steady state condition is satidfied
+
+    int sign = 1; //change sign to -1*sign whenever abs(Phi_Bc_hi) == Phi_Bc_hi_max to do triangular wave sweep
+    int num_Vapp = 0;
+    Real tiny = 1.e-6;    
+
+    // last completed step; nonzero when restarting from a checkpoint
+    int restart_step = 0;
+
     amrex::LPInfo info;
     std::unique_ptr<amrex::MLMG> pMLMG;
     std::unique_ptr<amrex::MLABecLaplacian> p_mlabec;
@@ -196,60 +347,146 @@ void main_main (c_FerroX& rFerroX)
     std::unique_ptr<amrex::MLEBABecLap> p_mlebabec;
     SetupMLMG_EB(pMLMG, p_mlebabec, LinOpBCType_2d, n_cell, beta_face, beta_cc, rFerroX, PoissonPhi, time, info);
 #endif
+    init_timer.Mark("MLMG setup");
     
     // INITIALIZE P in FE and rho in SC regions
 
     //InitializePandRho(P_old, Gamma, charge_den, e_den, hole_den, geom, prob_lo, prob_hi);//old
-    InitializePandRho(P_old, Gamma, charge_den, e_den, hole_den, MaterialMask, tphaseMask, n_cell, geom, prob_lo, prob_hi);//mask based
-    
+    InitializePandRho(P_old, Gamma, charge_den, e_den, hole_den, MaterialMask, tphaseMask, geom, prob_lo, prob_hi);//mask based
+    init_timer.Mark("P and rho");
+
+    bool E_restored = false;
+    if (!restart_file.empty()) {
+
+        // overwrite the initial P and rho and take the potential and E from the checkpoint
+        E_restored = ReadCheckpoint(restart_file, restart_step, time, sign, num_Vapp, steady_state_step,
+                                    P_old, E, PoissonPhi, PoissonPhi_Old, PoissonPhi_E, hole_den, e_den, charge_den, geom);
+        // the solver takes the contact values from the ghost cells; afterwards they hold
+        // what a solve leaves there, as in the step that wrote the checkpoint
+        SetPhiBC_z(PoissonPhi, n_cell, geom);
+#ifdef AMREX_USE_EB
+        p_mlebabec->setLevelBC(amrlev, &PoissonPhi);
+#else
+        p_mlabec->setLevelBC(amrlev, &PoissonPhi);
+#endif
+        SetPhiBC_z_Solved(PoissonPhi, n_cell[zdir]);
+        init_timer.Mark("read checkpoint");
+
+    } else {
+
 #ifdef AMREX_USE_EB
-    ComputePhi_Rho_EB(pMLMG, p_mlebabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, PhiErr, 
+    ComputePhi_Rho_EB(pMLMG, p_mlebabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, 
                    P_old, charge_den, e_den, hole_den, MaterialMask, 
                    angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
 #else
-    ComputePhi_Rho(pMLMG, p_mlabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, PhiErr, 
+    ComputePhi_Rho(pMLMG, p_mlabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, 
                    P_old, charge_den, e_den, hole_den, MaterialMask, 
                    angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
 #endif
 
+    }
+
     // Calculate E from Phi
-    ComputeEfromPhi(PoissonPhi, E, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
+    if (compute_E_on_the_fly == 0 && !E_restored) {
+        ComputeEfromPhi(PoissonPhi, E, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
+    }
+    if (compute_E_on_the_fly == 1 && !E_restored) {
+        MultiFab::Copy(PoissonPhi_E, PoissonPhi, 0, 0, 1, PoissonPhi.nGrowVect());
+    }
+
+    init_timer.Mark("initial Poisson solve");
+
+    // in compute_E_on_the_fly mode, E is computed into temporary storage only when it is plotted
+    auto MaterializeEForOutput = [&] ()
+    {
+        if (compute_E_on_the_fly == 1 && plot_E) {
+            for (int dir = 0; dir < 3; dir++) E[dir].define(ba, dm, Ncomp, 0);
+            ComputeEfromPhi(PoissonPhi_E, E, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
+        }
+    };
+    auto ReleaseEAfterOutput = [&] ()
+    {
+        if (compute_E_on_the_fly == 1) {
+            for (int dir = 0; dir < 3; dir++) E[dir].clear();
+        }
+    };
+
+    // Reduced diagnostics of the initial state
+    if (diag_int > 0 && restart_step == 0)
+    {
+        WriteReducedDiagnostics(0, time, P_old, PoissonPhi, charge_den, beta_cc, MaterialMask,
+                                angle_alpha, angle_beta, angle_theta, geom);
+    }
+
+    // Point and line probes (probes.*), buffered on each rank between flushes
+    FerroXProbes probes;
+    probes.Init(geom, ba, dm);
+    if (restart_step == 0) probes.Sample(0, time, PoissonPhi, P_old);
+
+    // Write the static fields once; they are left out of the per-step plotfiles
+    if (plot_int > 0 && plot_static_once == 1)
+    {
+        WriteStaticPlotfile(rFerroX, beta_cc, MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta, GrainID, geom);
+    }
 
     // Write a plotfile of the initial data if plot_int > 0
-    if (plot_int > 0)
+    if (plot_int > 0 && restart_step == 0)
     {
         int plt_step = 0;
+        MaterializeEForOutput();
         WritePlotfile(rFerroX, PoissonPhi, PoissonRHS, P_old, E, hole_den, e_den, charge_den, beta_cc, 
-                      MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta, Phidiff, geom, time, plt_step);
+                      MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta, Phidiff, GrainID, geom, time, plt_step);
+        ReleaseEAfterOutput();
     }
 
-    amrex::Print() << "\n ========= Advance Steps  ========== \n"<< std::endl;
+    init_timer.Mark("initial plotfile");
+    init_timer.Print("Initialization timing");
+
+    if (wide_halo == 1) {
+        // polarization exchanges per step of the second-order integrator: the predictor P_new_pre
+        // and the new P_old (width 1) without wide_halo, only P_old (width Nghost) with it
+        const int n_fill_narrow = 2*3;
+        const int n_fill_wide = 3;
+        Long msgs_narrow, bytes_narrow, msgs_wide, bytes_wide;
+        FerroX_Perf::HaloTraffic(P_old[0], 1, geom.periodicity(), msgs_narrow, bytes_narrow);
+        FerroX_Perf::HaloTraffic(P_old[0], Nghost, geom.periodicity(), msgs_wide, bytes_wide);
+        amrex::Print() << "Wide halo: " << Nghost << " polarization ghost cells, predictor computed on "
+                       << halo_ngrow << " ghost layer(s)\n"
+                       << "  polarization FillBoundary calls per step (TimeIntegratorOrder = " << TimeIntegratorOrder << "): "
+                       << n_fill_wide << " instead of " << n_fill_narrow << ", "
+                       << n_fill_wide*msgs_wide << " instead of " << n_fill_narrow*msgs_narrow << " messages ("
+                       << n_fill_narrow*msgs_narrow - n_fill_wide*msgs_wide << " saved), "
+                       << n_fill_wide*bytes_wide << " instead of " << n_fill_narrow*bytes_narrow << " bytes\n";
+    }
 
-    int steady_state_step = 1000000; //Initialize to a large number. It will be overwritten by the time step at which steady state condition is satidfied
+    amrex::Print() << "\n ========= Advance Steps  ========== \n"<< std::endl;
 
-    int sign = 1; //change sign to -1*sign whenever abs(Phi_Bc_hi) == Phi_Bc_hi_max to do triangular wave sweep
-    int num_Vapp = 0;
-    Real tiny = 1.e-6;    
  
-    for (int step = 1; step <= nsteps; ++step)
+    int last_step = restart_step;
+    for (int step = restart_step + 1; step <= nsteps; ++step)
     {
         Real step_strt_time = ParallelDescriptor::second();
+        last_step = step;
+        FerroX_Telemetry::BeginStep(step);
 
-        // compute f^n = f(P^n,Phi^n)
-        CalculateTDGL_RHS(GL_rhs, P_old, E, Gamma, MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
+        // compute f^n = f(P^n,Phi^n), with wide_halo also on the inner ghost layers
+        CalculateTDGL_RHS(GL_rhs, P_old, E, PoissonPhi_TDGL, Gamma, MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi, halo_ngrow);
 
         // P^{n+1,*} = P^n + dt * f^n
         for (int i = 0; i < 3; i++){
-            MultiFab::LinComb(P_new_pre[i], 1.0, P_old[i], 0, dt, GL_rhs[i], 0, 0, 1, Nghost);
-            P_new_pre[i].FillBoundary(geom.periodicity()); 
+            {
+                FERROX_PROFILE("TimeIntegrator::LinComb");
+                MultiFab::LinComb(P_new_pre[i], 1.0, P_old[i], 0, dt, GL_rhs[i], 0, 0, 1, Nghost_update);
+            }
+            if (wide_halo == 0) FerroX_Perf::FillBoundary(P_new_pre[i], geom.periodicity());
         }  
 	
 #ifdef AMREX_USE_EB
-        ComputePhi_Rho_EB(pMLMG, p_mlebabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, PhiErr, 
+        ComputePhi_Rho_EB(pMLMG, p_mlebabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, 
                    P_new_pre, charge_den, e_den, hole_den, MaterialMask, 
                    angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
 #else
-        ComputePhi_Rho(pMLMG, p_mlabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, PhiErr, 
+        ComputePhi_Rho(pMLMG, p_mlabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, 
                    P_new_pre, charge_den, e_den, hole_den, MaterialMask, 
                    angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
 #endif
@@ -258,69 +495,99 @@ void main_main (c_FerroX& rFerroX)
 
             // copy new solution into old solution
             for (int i = 0; i < 3; i++){
-                MultiFab::Copy(P_old[i], P_new_pre[i], 0, 0, 1, 0);
-                // fill periodic ghost cells
-                P_old[i].FillBoundary(geom.periodicity());
-                P_new_pre[i].FillBoundary(geom.periodicity());
+                {
+                    FERROX_PROFILE("TimeIntegrator::Copy");
+                    MultiFab::Copy(P_old[i], P_new_pre[i], 0, 0, 1, 0);
+                }
+                // fill periodic ghost cells; P_new_pre is overwritten, halo included, by the next predictor
+                FerroX_Perf::FillBoundary(P_old[i], geom.periodicity());
             }
             
         } else {
         
             // compute f^{n+1,*} = f(P^{n+1,*},Phi^{n+1,*})
-            CalculateTDGL_RHS(GL_rhs_pre, P_new_pre, E, Gamma, MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
+            CalculateTDGL_RHS(GL_rhs_pre, P_new_pre, E, PoissonPhi_TDGL, Gamma, MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
 
             // P^{n+1} = P^n + dt/2 * f^n + dt/2 * f^{n+1,*}
             for (int i = 0; i < 3; i++){
-                MultiFab::LinComb(GL_rhs_avg[i], 0.5, GL_rhs[i], 0, 0.5, GL_rhs_pre[i], 0, 0, 1, Nghost);    
-                MultiFab::LinComb(P_new[i], 1.0, P_old[i], 0, dt, GL_rhs_avg[i], 0, 0, 1, Nghost);
+                FERROX_PROFILE("TimeIntegrator::LinComb");
+                MultiFab::LinComb(P_new[i], 1.0, P_old[i], 0, 0.5*dt, GL_rhs[i], 0, 0, 1, Nghost_update);
+                MultiFab::Saxpy(P_new[i], 0.5*dt, GL_rhs_pre[i], 0, 0, 1, 0);
             }
         
 #ifdef AMREX_USE_EB
-            ComputePhi_Rho_EB(pMLMG, p_mlebabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, PhiErr, 
+            ComputePhi_Rho_EB(pMLMG, p_mlebabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, 
                    P_new, charge_den, e_den, hole_den, MaterialMask, 
                    angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
 #else
-            ComputePhi_Rho(pMLMG, p_mlabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, PhiErr, 
+            ComputePhi_Rho(pMLMG, p_mlabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, 
                    P_new, charge_den, e_den, hole_den, MaterialMask, 
                    angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
 #endif
 
             // copy new solution into old solution
             for (int i = 0; i < 3; i++){
-                MultiFab::Copy(P_old[i], P_new[i], 0, 0, 1, 0);
+                {
+                    FERROX_PROFILE("TimeIntegrator::Copy");
+                    MultiFab::Copy(P_old[i], P_new[i], 0, 0, 1, 0);
+                }
                 // fill periodic ghost cells
-                P_old[i].FillBoundary(geom.periodicity());
+                FerroX_Perf::FillBoundary(P_old[i], geom.periodicity());
             }
     	}
 
         // Check if steady state has reached 
-        CheckSteadyState(PoissonPhi, PoissonPhi_Old, Phidiff, phi_tolerance, step, steady_state_step, inc_step);
+        if (steady_state_criterion == "energy") {
+            CheckSteadyStateEnergy(P_old, GL_rhs, PoissonPhi, beta_cc, MaterialMask, angle_alpha, angle_beta, angle_theta,
+                                   geom, step, steady_state_step, inc_step);
+        } else {
+            CheckSteadyState(PoissonPhi, PoissonPhi_Old, Phidiff, phi_tolerance, step, steady_state_step, inc_step);
+        }
 
 	    // Calculate E from Phi
-	    ComputeEfromPhi(PoissonPhi, E, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
+	    if (compute_E_on_the_fly == 0) {
+	        ComputeEfromPhi(PoissonPhi, E, angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
+	    } else {
+	        MultiFab::Copy(PoissonPhi_E, PoissonPhi, 0, 0, 1, PoissonPhi.nGrowVect());
+	    }
 
 
 	    Real step_stop_time = ParallelDescriptor::second() - step_strt_time;
-        ParallelDescriptor::ReduceRealMax(step_stop_time);
 
-        amrex::Print() << "Advanced step " << step << " in " << step_stop_time << " seconds\n";
-        amrex::Print() << " \n";
+        // local step time; reduced and printed every step_log_int steps
+        FerroX_Telemetry::EndStep(step, step_stop_time);
 
         // update time
         time = time + dt;
 
+        FerroX_Perf::EndStep(step, time, step_stop_time);
+
+        probes.Sample(step, time, PoissonPhi, P_old);
+
+        // Reduced diagnostics; the row at inc_step is the converged state of the current voltage
+        if (diag_int > 0 && (step%diag_int == 0 || step == inc_step))
+        {
+            WriteReducedDiagnostics(step, time, P_old, PoissonPhi, charge_den, beta_cc, MaterialMask,
+                                    angle_alpha, angle_beta, angle_theta, geom);
+        }
+
 
         // Write a plotfile of the current data (plot_int was defined in the inputs file)
         if (plot_int > 0 && (step%plot_int == 0 || step == steady_state_step))
         {
             int plt_step = step;
+            MaterializeEForOutput();
             WritePlotfile(rFerroX, PoissonPhi, PoissonRHS, P_old, E, hole_den, e_den, charge_den, beta_cc, 
-                      MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta, Phidiff, geom, time, plt_step);
+                      MaterialMask, tphaseMask, angle_alpha, angle_beta, angle_theta, Phidiff, GrainID, geom, time, plt_step);
+            ReleaseEAfterOutput();
             
         }
 
         if(voltage_sweep == 1 && inc_step > 0 && step == inc_step)
         {
+           // this step has been logged; the solve at the new voltage is logged with the next one
+           FerroX_Telemetry::BeginCarry(step+1);
+
            //Update time-dependent Boundary Condition of Poisson's equation
 
             Phi_Bc_hi += sign*Phi_Bc_inc;
@@ -342,16 +609,24 @@ void main_main (c_FerroX& rFerroX)
 #endif
 
 #ifdef AMREX_USE_EB
-           ComputePhi_Rho_EB(pMLMG, p_mlebabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, PhiErr, 
+           ComputePhi_Rho_EB(pMLMG, p_mlebabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, 
                    P_old, charge_den, e_den, hole_den, MaterialMask, 
                    angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
 #else
-           ComputePhi_Rho(pMLMG, p_mlabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, PhiErr, 
+           ComputePhi_Rho(pMLMG, p_mlabec, alpha_cc, PoissonRHS, PoissonPhi, PoissonPhi_Prev, 
                    P_old, charge_den, e_den, hole_den, MaterialMask, 
                    angle_alpha, angle_beta, angle_theta, geom, prob_lo, prob_hi);
 #endif
+           FerroX_Telemetry::EndCarry();
            
         }//end inc_step	
+
+        // Write a checkpoint of the state at the end of this step
+        if (chk_int > 0 && step%chk_int == 0)
+        {
+            WriteCheckpoint(step, time, sign, num_Vapp, steady_state_step,
+                            P_old, E, PoissonPhi, PoissonPhi_Old, PoissonPhi_E, hole_den, e_den, charge_den);
+        }
    
         if (voltage_sweep == 0 && step == steady_state_step) {
            amrex::Print() << "voltage_sweep == 0 && step == steady_state_step!" << "\n";   
@@ -372,6 +647,18 @@ void main_main (c_FerroX& rFerroX)
 
     } // end step
 
+    // summarize the steps since the last log line
+    FerroX_Telemetry::Flush();
+
+    // write the remaining probe samples
+    probes.Flush();
+
+    // make sure all plotfiles are on disk before reporting
+    FinishPlotfileOutput();
+
+    // norms of the final state, compared by Exec/regression_inputs/regression.py
+    FerroX_Util::PrintFingerprint(P_old, PoissonPhi);
+
     // MultiFab memory usage
     const int IOProc = ParallelDescriptor::IOProcessorNumber();
 
@@ -392,10 +679,16 @@ void main_main (c_FerroX& rFerroX)
 
     amrex::Print() << "Curent     FAB megabyte spread across MPI nodes: ["
                    << min_fab_megabytes << " ... " << max_fab_megabytes << "]\n";
+
+    // break the totals above down by field; the remainder is MLMG, plotfile and temporary storage
+    FerroX_Util::PrintMemoryLedger("Field memory ledger (end of run)", ba.numPts());
     
     Real total_step_stop_time = ParallelDescriptor::second() - total_step_strt_time;
     ParallelDescriptor::ReduceRealMax(total_step_stop_time);
 
     amrex::Print() << "Total run time " << total_step_stop_time << " seconds\n";
+    PrintPlotfileTiming();
+
+    FerroX_Perf::WriteReport(ba, last_step - restart_step, total_step_stop_time);
 
 }